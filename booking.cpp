@@ -37,6 +37,9 @@ CREATE TABLE bookings (
     total_fare DECIMAL(10,2) NOT NULL,
     booking_status ENUM('Confirmed', 'Waiting', 'Cancelled') DEFAULT 'Confirmed',
     payment_status ENUM('Paid', 'Pending') DEFAULT 'Pending',
+    from_stop INT NOT NULL DEFAULT 0,  -- Stop indexes in train_stops order; -1 is the final stop
+    to_stop INT NOT NULL DEFAULT -1,
+    booking_key CHAR(32) UNIQUE,  -- Set on journaled bookings so a replay can tell they committed
     FOREIGN KEY (user_id) REFERENCES users(user_id),
     FOREIGN KEY (train_id) REFERENCES trains(train_id)
 );
@@ -51,11 +54,29 @@ CREATE TABLE passengers (
     FOREIGN KEY (booking_id) REFERENCES bookings(booking_id) ON DELETE CASCADE
 );
 
+-- Full route from source to destination; a train without rows runs nonstop
+CREATE TABLE train_stops (
+    train_id INT NOT NULL,
+    stop_sequence INT NOT NULL,
+    station VARCHAR(100) NOT NULL,
+    arrival_time TIME,
+    departure_time TIME,
+    PRIMARY KEY (train_id, stop_sequence),
+    FOREIGN KEY (train_id) REFERENCES trains(train_id)
+);
+
 -- Sample data
 INSERT INTO trains (train_name, train_number, source, destination, departure_time, arrival_time, total_seats) VALUES
 ('Rajdhani Express', 'RAJ2025', 'Delhi', 'Mumbai', '16:00:00', '08:00:00', 500),
 ('Shatabdi Express', 'SHT1050', 'Chennai', 'Bangalore', '06:00:00', '10:30:00', 400),
 ('Duronto Express', 'DUR2210', 'Kolkata', 'Delhi', '23:00:00', '14:00:00', 450);
+
+INSERT INTO train_stops (train_id, stop_sequence, station, arrival_time, departure_time) VALUES
+(1, 0, 'Delhi', NULL, '16:00:00'),
+(1, 1, 'Kota', '21:30:00', '21:40:00'),
+(1, 2, 'Vadodara', '03:20:00', '03:30:00'),
+(1, 3, 'Surat', '05:00:00', '05:05:00'),
+(1, 4, 'Mumbai', '08:00:00', NULL);
 */
 
 // ============= HEADER FILES =============
@@ -64,8 +85,53 @@ INSERT INTO trains (train_name, train_number, source, destination, departure_tim
 #include <vector>
 #include <iomanip>
 #include <ctime>
+#include <cstdio>
+#include <cstdint>
 #include <limits>
 #include <memory>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <future>
+#include <functional>
+#include <type_traits>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <random>
+#include <cstdlib>
+#include <cctype>
+#include <iterator>
+#include <queue>
+#include <cmath>
+#include <climits>
+#include <sstream>
+#include <fstream>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
 #include <mysql_connection.h>
 #include <cppconn/driver.h>
 #include <cppconn/exception.h>
@@ -78,9 +144,29 @@ using namespace std;
 // ============= UTILITY FUNCTIONS =============
 class Utility {
 public:
+    // Thread-safe localtime; the server and benchmark call this from many threads
+    static tm localTime(time_t time) {
+        tm result;
+        #ifdef _WIN32
+            localtime_s(&result, &time);
+        #else
+            localtime_r(&time, &result);
+        #endif
+        return result;
+    }
+    
+    // 128 random bits as hex
+    static string randomKey() {
+        static thread_local random_device entropy;
+        char buffer[33];
+        snprintf(buffer, sizeof(buffer), "%08x%08x%08x%08x", entropy(), entropy(), entropy(), entropy());
+        return buffer;
+    }
+    
     static string getCurrentDate() {
         time_t now = time(0);
-        tm* ltm = localtime(&now);
+        tm local = localTime(now);
+        tm* ltm = &local;
         
         string year = to_string(1900 + ltm->tm_year);
         string month = to_string(1 + ltm->tm_mon);
@@ -92,6 +178,63 @@ public:
         return year + "-" + month + "-" + day;
     }
     
+    // Minutes after midnight for an HH:MM[:SS] time, or -1 if it does not parse
+    static int minutesOfDay(const string& time) {
+        int hours = 0, minutes = 0;
+        if (sscanf(time.c_str(), "%d:%d", &hours, &minutes) != 2 || hours < 0 || hours > 23 || minutes < 0 || minutes > 59) {
+            return -1;
+        }
+        return hours * 60 + minutes;
+    }
+    
+    // Zero-pad a YYYY-M-D date so equal dates always produce the same string
+    static string normalizeDate(const string& date) {
+        int year, month, day;
+        char trailing;
+        if (sscanf(date.c_str(), "%d-%d-%d%c", &year, &month, &day, &trailing) != 3) {
+            return date;
+        }
+        
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month, day);
+        return buffer;
+    }
+    
+    // Days since 1970-01-01 for a YYYY-MM-DD date (proleptic Gregorian); false if unparsable
+    static bool dayNumber(const string& date, long& days) {
+        int year, month, day;
+        char trailing;
+        if (sscanf(date.c_str(), "%d-%d-%d%c", &year, &month, &day, &trailing) != 3 ||
+            month < 1 || month > 12 || day < 1 || day > 31) {
+            return false;
+        }
+        
+        year -= month <= 2;
+        long era = (year >= 0 ? year : year - 399) / 400;
+        long yearOfEra = year - era * 400;
+        long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        days = era * 146097 + dayOfEra - 719468;
+        return true;
+    }
+    
+    // Inverse of dayNumber, as YYYY-MM-DD
+    static string dateFromDayNumber(long days) {
+        days += 719468;
+        long era = (days >= 0 ? days : days - 146096) / 146097;
+        long dayOfEra = days - era * 146097;
+        long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        long monthIndex = (5 * dayOfYear + 2) / 153;
+        long day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        long month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        long year = yearOfEra + era * 400 + (month <= 2);
+        
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%04ld-%02ld-%02ld", year, month, day);
+        return buffer;
+    }
+    
     static void clearScreen() {
         #ifdef _WIN32
             system("cls");
@@ -153,1322 +296,8571 @@ public:
     }
 };
 
-// ============= DATABASE CONNECTION =============
-class DatabaseConnector {
+// ============= METRICS =============
+// Count, error count and latency histogram for one named operation. Recording is a
+// handful of relaxed atomic increments, so it is safe and cheap from any thread.
+class OperationMetrics {
+public:
+    // Upper bounds of the latency buckets in nanoseconds (10us to 5s); the last bucket is +Inf
+    static const size_t bucketCount = 18;
+    
+    static const uint64_t* bucketBounds() {
+        static const uint64_t bounds[bucketCount] = {
+            10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000,
+            10000000, 25000000, 50000000, 100000000, 250000000, 500000000,
+            1000000000, 2500000000ULL, 5000000000ULL
+        };
+        return bounds;
+    }
+
 private:
-    sql::Driver* driver;
-    sql::Connection* con;
-    const string server = "tcp://127.0.0.1:3306";
-    const string username = "root";
-    const string password = "password"; // Change to your MySQL password
+    atomic<uint64_t> count;
+    atomic<uint64_t> errors;
+    atomic<uint64_t> totalNanos;
+    atomic<uint64_t> buckets[bucketCount + 1];
 
 public:
-    DatabaseConnector() {
-        try {
-            driver = get_driver_instance();
-            con = driver->connect(server, username, password);
-            con->setSchema("railway_booking_system");
-            cout << "Database connection established successfully.\n";
-        } catch (sql::SQLException &e) {
-            cout << "# ERR: SQLException in " << __FILE__;
-            cout << "(" << __FUNCTION__ << ") on line " << __LINE__ << endl;
-            cout << "# ERR: " << e.what();
-            cout << " (MySQL error code: " << e.getErrorCode();
-            cout << ", SQLState: " << e.getSQLState() << " )" << endl;
-            exit(1);
-        }
+    OperationMetrics() : count(0), errors(0), totalNanos(0) {
+        for (auto& bucket : buckets) bucket.store(0);
     }
     
-    ~DatabaseConnector() {
-        delete con;
+    void record(uint64_t nanos, bool failed) {
+        count.fetch_add(1, memory_order_relaxed);
+        totalNanos.fetch_add(nanos, memory_order_relaxed);
+        const uint64_t* bounds = bucketBounds();
+        buckets[lower_bound(bounds, bounds + bucketCount, nanos) - bounds].fetch_add(1, memory_order_relaxed);
+        if (failed) errors.fetch_add(1, memory_order_relaxed);
     }
     
-    sql::Connection* getConnection() {
-        return con;
-    }
+    // Getters
+    uint64_t getCount() const { return count.load(memory_order_relaxed); }
+    uint64_t getErrors() const { return errors.load(memory_order_relaxed); }
+    double getTotalSeconds() const { return totalNanos.load(memory_order_relaxed) / 1e9; }
+    uint64_t getBucket(size_t index) const { return buckets[index].load(memory_order_relaxed); }
 };
 
-// ============= BASE CLASSES =============
-class Person {
-protected:
-    string name;
-    string email;
-    string phone;
+// Times a scope into an OperationMetrics. The operation counts as failed if fail() was
+// called or the scope is left by an exception.
+class OperationTimer {
+private:
+    OperationMetrics& metrics;
+    chrono::steady_clock::time_point start;
+    bool failed;
+    
+    static bool unwinding() {
+        #if __cplusplus >= 201703L
+            return uncaught_exceptions() > 0;
+        #else
+            return uncaught_exception();
+        #endif
+    }
 
 public:
-    Person() : name(""), email(""), phone("") {}
-    Person(string name, string email, string phone) 
-        : name(name), email(email), phone(phone) {}
-    
-    virtual ~Person() {}
+    OperationTimer(OperationMetrics& metrics)
+        : metrics(metrics), start(chrono::steady_clock::now()), failed(false) {}
     
-    // Getters
-    string getName() const { return name; }
-    string getEmail() const { return email; }
-    string getPhone() const { return phone; }
+    ~OperationTimer() {
+        uint64_t nanos = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - start).count();
+        metrics.record(nanos, failed || unwinding());
+    }
     
-    // Setters
-    void setName(const string& name) { this->name = name; }
-    void setEmail(const string& email) { this->email = email; }
-    void setPhone(const string& phone) { this->phone = phone; }
+    OperationTimer(const OperationTimer&) = delete;
+    OperationTimer& operator=(const OperationTimer&) = delete;
     
-    virtual void displayInfo() const = 0; // Pure virtual function
+    void fail() { failed = true; }
 };
 
-// ============= USER CLASSES =============
-class User : public Person {
+// Process-wide registry. Looking up a series takes a lock, so call sites look theirs
+// up once and keep the reference (function-local statics), e.g.
+//
+//   static OperationMetrics& metrics = Metrics::operation("createBooking");
+//   OperationTimer timer(metrics);
+//
+// Series are never removed, so the references stay valid for the life of the process.
+class Metrics {
 private:
-    int userId;
-    string username;
-    string password;
-    string registrationDate;
-
-public:
-    User() : Person(), userId(0), username(""), password(""), registrationDate("") {}
+    struct HistogramSeries {
+        string family;
+        string labels;
+        OperationMetrics metrics;
+    };
     
-    User(int userId, string username, string password, string name, string email, string phone, string regDate)
-        : Person(name, email, phone), userId(userId), username(username), password(password), registrationDate(regDate) {}
+    struct CounterSeries {
+        string family;
+        string labels;
+        atomic<uint64_t> value;
+    };
     
-    // Getters
-    int getUserId() const { return userId; }
-    string getUsername() const { return username; }
-    string getPassword() const { return password; }
-    string getRegistrationDate() const { return registrationDate; }
+    mutex registryMutex;
+    deque<HistogramSeries> histograms; // deque: growing never moves existing series
+    deque<CounterSeries> counters;
+    map<pair<string, string>, OperationMetrics*> histogramIndex;
+    map<pair<string, string>, atomic<uint64_t>*> counterIndex;
+    map<string, string> help; // Histograms: what is being timed; counters: the full help text
     
-    // Setters
-    void setUserId(int id) { userId = id; }
-    void setUsername(const string& uname) { username = uname; }
-    void setPassword(const string& pwd) { password = pwd; }
-    void setRegistrationDate(const string& date) { registrationDate = date; }
+    static Metrics& instance() {
+        static Metrics registry;
+        return registry;
+    }
     
-    void displayInfo() const override {
-        cout << "User ID: " << userId << endl;
-        cout << "Username: " << username << endl;
-        cout << "Name: " << name << endl;
-        cout << "Email: " << email << endl;
-        cout << "Phone: " << phone << endl;
-        cout << "Registration Date: " << registrationDate << endl;
+    OperationMetrics& findHistogram(const string& family, const string& labels, const string& description) {
+        lock_guard<mutex> lock(registryMutex);
+        
+        auto it = histogramIndex.find(make_pair(family, labels));
+        if (it != histogramIndex.end()) return *it->second;
+        
+        histograms.emplace_back();
+        histograms.back().family = family;
+        histograms.back().labels = labels;
+        histogramIndex[make_pair(family, labels)] = &histograms.back().metrics;
+        help[family] = description;
+        return histograms.back().metrics;
+    }
+    
+    atomic<uint64_t>& findCounter(const string& family, const string& labels, const string& description) {
+        lock_guard<mutex> lock(registryMutex);
+        
+        auto it = counterIndex.find(make_pair(family, labels));
+        if (it != counterIndex.end()) return *it->second;
+        
+        counters.emplace_back();
+        counters.back().family = family;
+        counters.back().labels = labels;
+        counters.back().value.store(0);
+        counterIndex[make_pair(family, labels)] = &counters.back().value;
+        help[family] = description;
+        return counters.back().value;
+    }
+    
+    // Exposition needs every series of a family together, whatever the registration order
+    template<typename Series>
+    static vector<const Series*> byFamily(const deque<Series>& all) {
+        vector<const Series*> sorted;
+        for (const auto& series : all) sorted.push_back(&series);
+        sort(sorted.begin(), sorted.end(), [](const Series* a, const Series* b) {
+            return a->family != b->family ? a->family < b->family : a->labels < b->labels;
+        });
+        return sorted;
     }
-};
-
-class UserManager {
-private:
-    DatabaseConnector* dbConnector;
     
+    static string withLabel(const string& labels, const string& extra) {
+        return "{" + labels + (labels.empty() ? "" : ",") + extra + "}";
+    }
+
 public:
-    UserManager(DatabaseConnector* connector) : dbConnector(connector) {}
+    // A manager-level operation such as createBooking or loginUser
+    static OperationMetrics& operation(const string& name) {
+        return instance().findHistogram("railway_operation", "operation=\"" + name + "\"",
+                                        "booking system operations");
+    }
     
-    bool registerUser(User& user) {
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "INSERT INTO users(username, password, full_name, email, phone) VALUES(?, ?, ?, ?, ?)");
-            
-            pstmt->setString(1, user.getUsername());
-            pstmt->setString(2, user.getPassword());
-            pstmt->setString(3, user.getName());
-            pstmt->setString(4, user.getEmail());
-            pstmt->setString(5, user.getPhone());
-            
-            pstmt->executeUpdate();
-            
-            // Get the user ID of the newly registered user
-            sql::Statement* stmt = con->createStatement();
-            sql::ResultSet* res = stmt->executeQuery("SELECT LAST_INSERT_ID() as id");
+    // A single storage round trip, one per SQL statement group
+    static OperationMetrics& query(const string& name) {
+        return instance().findHistogram("railway_query", "query=\"" + name + "\"",
+                                        "database queries");
+    }
+    
+    // Time spent waiting for a pooled database connection; errors are timeouts
+    static OperationMetrics& poolWait() {
+        return instance().findHistogram("railway_pool_wait", "", "waits for a pooled database connection");
+    }
+    
+    // Reads sent to a replica or, lacking a usable one, to the primary
+    static atomic<uint64_t>& readRoutes(const string& target) {
+        return instance().findCounter("railway_read_routes_total", "target=\"" + target + "\"",
+                                      "Read-only queries by the server they were routed to");
+    }
+    
+    // Hit and miss counters for a named cache
+    static atomic<uint64_t>& cacheRequests(const string& cache, bool hit) {
+        return instance().findCounter("railway_cache_requests_total",
+                                      "cache=\"" + cache + "\",result=\"" + (hit ? "hit" : "miss") + "\"",
+                                      "Cache lookups by result");
+    }
+    
+    // Everything recorded so far in the Prometheus text exposition format
+    static string renderPrometheus() {
+        Metrics& registry = instance();
+        lock_guard<mutex> lock(registry.registryMutex);
+        ostringstream out;
+        string lastFamily;
+        
+        vector<const HistogramSeries*> histograms = byFamily(registry.histograms);
+        vector<const CounterSeries*> counters = byFamily(registry.counters);
+        
+        for (const HistogramSeries* entry : histograms) {
+            const HistogramSeries& series = *entry;
+            string name = series.family + "_duration_seconds";
+            const OperationMetrics& m = series.metrics;
             
-            if (res->next()) {
-                user.setUserId(res->getInt("id"));
+            if (series.family != lastFamily) {
+                out << "# HELP " << name << " Latency of " << registry.help[series.family] << "\n";
+                out << "# TYPE " << name << " histogram\n";
             }
             
-            delete pstmt;
-            delete stmt;
-            delete res;
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i <= OperationMetrics::bucketCount; i++) {
+                cumulative += m.getBucket(i);
+                ostringstream bound;
+                if (i < OperationMetrics::bucketCount) bound << OperationMetrics::bucketBounds()[i] / 1e9;
+                else bound << "+Inf";
+                out << name << "_bucket" << withLabel(series.labels, "le=\"" + bound.str() + "\"") << " " << cumulative << "\n";
+            }
             
-            return true;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return false;
+            string labels = series.labels.empty() ? "" : "{" + series.labels + "}";
+            out << name << "_sum" << labels << " " << setprecision(9) << m.getTotalSeconds() << "\n";
+            out << name << "_count" << labels << " " << m.getCount() << "\n";
+            lastFamily = series.family;
         }
+        
+        lastFamily.clear();
+        for (const HistogramSeries* entry : histograms) {
+            const HistogramSeries& series = *entry;
+            string name = series.family + "_errors_total";
+            if (series.family != lastFamily) {
+                out << "# HELP " << name << " Failed " << registry.help[series.family] << "\n";
+                out << "# TYPE " << name << " counter\n";
+            }
+            out << name << (series.labels.empty() ? "" : "{" + series.labels + "}") << " "
+                << series.metrics.getErrors() << "\n";
+            lastFamily = series.family;
+        }
+        
+        lastFamily.clear();
+        for (const CounterSeries* entry : counters) {
+            const CounterSeries& series = *entry;
+            if (series.family != lastFamily) {
+                out << "# HELP " << series.family << " " << registry.help[series.family] << "\n";
+                out << "# TYPE " << series.family << " counter\n";
+            }
+            out << series.family << (series.labels.empty() ? "" : "{" + series.labels + "}") << " "
+                << series.value.load(memory_order_relaxed) << "\n";
+            lastFamily = series.family;
+        }
+        
+        return out.str();
     }
+};
+
+// ============= ASYNC EXECUTION =============
+// Fixed-size pool of worker threads. submit() queues a callable and returns a future
+// for its result (or exception). Used to overlap independent storage round trips;
+// a task must not block on futures of the same pool, or a full pool deadlocks.
+class ThreadPool {
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex queueMutex;
+    condition_variable queueCondition;
+    bool stopping;
     
-    User* loginUser(const string& username, const string& password) {
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "SELECT * FROM users WHERE username = ? AND password = ?");
-            
-            pstmt->setString(1, username);
-            pstmt->setString(2, password);
-            
-            sql::ResultSet* res = pstmt->executeQuery();
-            
-            if (res->next()) {
-                User* user = new User(
-                    res->getInt("user_id"),
-                    res->getString("username"),
-                    res->getString("password"),
-                    res->getString("full_name"),
-                    res->getString("email"),
-                    res->getString("phone"),
-                    res->getString("registration_date")
-                );
-                
-                delete pstmt;
-                delete res;
+    void workerLoop() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
                 
-                return user;
+                task = move(tasks.front());
+                tasks.pop();
             }
-            
-            delete pstmt;
-            delete res;
-            
-            return nullptr;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return nullptr;
+            task();
+        }
+    }
+
+public:
+    ThreadPool(size_t numThreads) : stopping(false) {
+        for (size_t i = 0; i < max(numThreads, (size_t)1); i++) {
+            workers.push_back(thread(&ThreadPool::workerLoop, this));
         }
     }
     
-    bool updateUserProfile(const User& user) {
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "UPDATE users SET full_name = ?, email = ?, phone = ? WHERE user_id = ?"
-            );
-            
-            pstmt->setString(1, user.getName());
-            pstmt->setString(2, user.getEmail());
-            pstmt->setString(3, user.getPhone());
-            pstmt->setInt(4, user.getUserId());
-            
-            pstmt->executeUpdate();
-            delete pstmt;
-            
-            return true;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return false;
+    // Runs every task already queued, then joins the workers
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
         }
+        queueCondition.notify_all();
+        for (auto& worker : workers) worker.join();
     }
     
-    bool changePassword(int userId, const string& newPassword) {
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "UPDATE users SET password = ? WHERE user_id = ?"
-            );
-            
-            pstmt->setString(1, newPassword);
-            pstmt->setInt(2, userId);
-            
-            pstmt->executeUpdate();
-            delete pstmt;
-            
-            return true;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return false;
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    template<typename F>
+    future<typename result_of<F()>::type> submit(F work) {
+        typedef typename result_of<F()>::type Result;
+        
+        // packaged_task is move-only and function<> needs a copyable target
+        shared_ptr<packaged_task<Result()>> task = make_shared<packaged_task<Result()>>(move(work));
+        future<Result> result = task->get_future();
+        {
+            lock_guard<mutex> lock(queueMutex);
+            tasks.push([task]() { (*task)(); });
         }
+        queueCondition.notify_one();
+        
+        return result;
     }
+    
+    size_t size() const { return workers.size(); }
 };
 
-// ============= TRAIN CLASSES =============
-class Train {
+// ============= DATABASE CONNECTION =============
+struct PoolStats {
+    size_t totalConnections;
+    size_t idleConnections;
+    size_t inUseConnections;
+    unsigned long long borrows;
+    unsigned long long timeouts;
+    unsigned long long reconnects;
+    unsigned long long discarded;
+    double avgWaitMs;
+    double maxWaitMs;
+    unsigned long long statementCacheHits;
+    unsigned long long statementCacheMisses;
+    unsigned long long statementCacheEvictions;
+};
+
+// Shared hit/miss/eviction counters for every connection's statement cache
+struct StatementCacheCounters {
+    atomic<unsigned long long> hits;
+    atomic<unsigned long long> misses;
+    atomic<unsigned long long> evictions;
+    
+    StatementCacheCounters() : hits(0), misses(0), evictions(0) {}
+};
+
+// Borrowed prepared statement; cached statements go back to their cache, uncached ones are deleted
+class PreparedStatementHandle {
 private:
-    int trainId;
-    string trainName;
-    string trainNumber;
-    string source;
-    string destination;
-    string departureTime;
-    string arrivalTime;
-    int totalSeats;
+    sql::PreparedStatement* stmt;
+    bool* inUse; // Points into the owning cache entry, nullptr when this handle owns stmt
 
 public:
-    Train() : trainId(0), trainName(""), trainNumber(""), source(""), destination(""),
-              departureTime(""), arrivalTime(""), totalSeats(0) {}
+    PreparedStatementHandle() : stmt(nullptr), inUse(nullptr) {}
+    PreparedStatementHandle(sql::PreparedStatement* stmt, bool* inUse) : stmt(stmt), inUse(inUse) {}
     
-    Train(int id, string name, string number, string src, string dest, 
-          string depTime, string arrTime, int seats)
-        : trainId(id), trainName(name), trainNumber(number), source(src), destination(dest),
-          departureTime(depTime), arrivalTime(arrTime), totalSeats(seats) {}
+    PreparedStatementHandle(PreparedStatementHandle&& other) : stmt(other.stmt), inUse(other.inUse) {
+        other.stmt = nullptr;
+        other.inUse = nullptr;
+    }
     
-    // Getters
-    int getTrainId() const { return trainId; }
-    string getTrainName() const { return trainName; }
-    string getTrainNumber() const { return trainNumber; }
-    string getSource() const { return source; }
-    string getDestination() const { return destination; }
-    string getDepartureTime() const { return departureTime; }
-    string getArrivalTime() const { return arrivalTime; }
-    int getTotalSeats() const { return totalSeats; }
+    PreparedStatementHandle& operator=(PreparedStatementHandle&& other) {
+        if (this != &other) {
+            reset();
+            stmt = other.stmt;
+            inUse = other.inUse;
+            other.stmt = nullptr;
+            other.inUse = nullptr;
+        }
+        return *this;
+    }
     
-    // Setters
-    void setTrainId(int id) { trainId = id; }
-    void setTrainName(const string& name) { trainName = name; }
-    void setTrainNumber(const string& number) { trainNumber = number; }
-    void setSource(const string& src) { source = src; }
-    void setDestination(const string& dest) { destination = dest; }
-    void setDepartureTime(const string& depTime) { departureTime = depTime; }
-    void setArrivalTime(const string& arrTime) { arrivalTime = arrTime; }
-    void setTotalSeats(int seats) { totalSeats = seats; }
+    PreparedStatementHandle(const PreparedStatementHandle&) = delete;
+    PreparedStatementHandle& operator=(const PreparedStatementHandle&) = delete;
     
-    void displayInfo() const {
-        cout << left << setw(5) << trainId
-             << setw(20) << trainName
-             << setw(12) << trainNumber
-             << setw(15) << source
-             << setw(15) << destination
-             << setw(12) << departureTime
-             << setw(12) << arrivalTime
-             << setw(8) << totalSeats << endl;
-    }
+    ~PreparedStatementHandle() { reset(); }
     
-    static void displayHeader() {
-        cout << left << setw(5) << "ID"
-             << setw(20) << "Train Name"
-             << setw(12) << "Number"
-             << setw(15) << "Source"
-             << setw(15) << "Destination"
-             << setw(12) << "Departure"
-             << setw(12) << "Arrival"
-             << setw(8) << "Seats" << endl;
-        cout << string(99, '-') << endl;
+    sql::PreparedStatement* get() const { return stmt; }
+    sql::PreparedStatement* operator->() const { return stmt; }
+    
+    void reset() {
+        if (inUse) {
+            *inUse = false;
+        } else {
+            delete stmt;
+        }
+        stmt = nullptr;
+        inUse = nullptr;
     }
 };
 
-class TrainManager {
+// Prepared statements of one connection, keyed by SQL text; the least recently used
+// idle statement is closed to make room once the cache is full
+class StatementCache {
 private:
-    DatabaseConnector* dbConnector;
+    struct Entry {
+        sql::PreparedStatement* stmt;
+        bool inUse;
+        list<string>::iterator recency;
+    };
     
-public:
-    TrainManager(DatabaseConnector* connector) : dbConnector(connector) {}
+    unordered_map<string, Entry> entries;
+    list<string> recency; // Most recently used first
+    size_t capacity;
+    StatementCacheCounters* counters;
     
-    vector<Train> searchTrains(const string& source, const string& destination) {
-        vector<Train> trains;
-        
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "SELECT * FROM trains WHERE source LIKE ? AND destination LIKE ?");
+    // Close the least recently used statement nobody is holding; false if all are borrowed
+    bool evictOne() {
+        for (auto it = recency.rbegin(); it != recency.rend(); ++it) {
+            auto entry = entries.find(*it);
+            if (entry->second.inUse) continue;
             
-            pstmt->setString(1, "%" + source + "%");
-            pstmt->setString(2, "%" + destination + "%");
-            
-            sql::ResultSet* res = pstmt->executeQuery();
-            
-            while (res->next()) {
-                Train train(
-                    res->getInt("train_id"),
-                    res->getString("train_name"),
-                    res->getString("train_number"),
-                    res->getString("source"),
-                    res->getString("destination"),
-                    res->getString("departure_time"),
-                    res->getString("arrival_time"),
-                    res->getInt("total_seats")
-                );
-                
-                trains.push_back(train);
-            }
-            
-            delete pstmt;
-            delete res;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
+            delete entry->second.stmt;
+            recency.erase(entry->second.recency);
+            entries.erase(entry);
+            counters->evictions++;
+            return true;
         }
-        
-        return trains;
+        return false;
     }
+
+public:
+    StatementCache(size_t capacity, StatementCacheCounters* counters)
+        : capacity(capacity), counters(counters) {}
     
-    vector<Train> getAllTrains() {
-        vector<Train> trains;
+    ~StatementCache() { clear(); }
+    
+    StatementCache(const StatementCache&) = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+    
+    PreparedStatementHandle prepare(sql::Connection* con, const string& sql) {
+        auto it = entries.find(sql);
         
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::Statement* stmt = con->createStatement();
-            sql::ResultSet* res = stmt->executeQuery("SELECT * FROM trains");
-            
-            while (res->next()) {
-                Train train(
-                    res->getInt("train_id"),
-                    res->getString("train_name"),
-                    res->getString("train_number"),
-                    res->getString("source"),
-                    res->getString("destination"),
-                    res->getString("departure_time"),
-                    res->getString("arrival_time"),
-                    res->getInt("total_seats")
-                );
-                
-                trains.push_back(train);
-            }
-            
-            delete stmt;
-            delete res;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
+        static atomic<uint64_t>& hitCount = Metrics::cacheRequests("statement", true);
+        static atomic<uint64_t>& missCount = Metrics::cacheRequests("statement", false);
+        
+        if (it != entries.end() && !it->second.inUse) {
+            counters->hits++;
+            hitCount.fetch_add(1, memory_order_relaxed);
+            it->second.inUse = true;
+            it->second.stmt->clearParameters();
+            recency.splice(recency.begin(), recency, it->second.recency);
+            return PreparedStatementHandle(it->second.stmt, &it->second.inUse);
         }
         
-        return trains;
-    }
-    
-    Train* getTrainById(int trainId) {
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement("SELECT * FROM trains WHERE train_id = ?");
-            
-            pstmt->setInt(1, trainId);
-            sql::ResultSet* res = pstmt->executeQuery();
-            
-            if (res->next()) {
-                Train* train = new Train(
-                    res->getInt("train_id"),
-                    res->getString("train_name"),
-                    res->getString("train_number"),
-                    res->getString("source"),
-                    res->getString("destination"),
-                    res->getString("departure_time"),
-                    res->getString("arrival_time"),
-                    res->getInt("total_seats")
-                );
-                
-                delete pstmt;
-                delete res;
-                
-                return train;
-            }
-            
-            delete pstmt;
-            delete res;
-            
-            return nullptr;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return nullptr;
+        counters->misses++;
+        missCount.fetch_add(1, memory_order_relaxed);
+        sql::PreparedStatement* stmt = con->prepareStatement(sql);
+        
+        // Same statement already borrowed on this connection, or every cached one is
+        if (it != entries.end() || capacity == 0 || (entries.size() >= capacity && !evictOne())) {
+            return PreparedStatementHandle(stmt, nullptr);
         }
+        
+        recency.push_front(sql);
+        Entry& entry = entries[sql];
+        entry.stmt = stmt;
+        entry.inUse = true;
+        entry.recency = recency.begin();
+        return PreparedStatementHandle(stmt, &entry.inUse);
     }
     
-    int getAvailableSeats(int trainId, const string& journeyDate) {
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "SELECT t.total_seats - COALESCE(SUM(b.num_passengers), 0) AS available_seats "
-                "FROM trains t LEFT JOIN bookings b ON t.train_id = b.train_id AND b.journey_date = ? AND b.booking_status = 'Confirmed' "
-                "WHERE t.train_id = ? GROUP BY t.train_id");
-            
-            pstmt->setString(1, journeyDate);
-            pstmt->setInt(2, trainId);
-            
-            sql::ResultSet* res = pstmt->executeQuery();
-            
-            int availableSeats = 0;
-            if (res->next()) {
-                availableSeats = res->getInt("available_seats");
-            } else {
-                // If no bookings found, get total seats from train
-                delete pstmt;
-                delete res;
-                
-                pstmt = con->prepareStatement("SELECT total_seats FROM trains WHERE train_id = ?");
-                pstmt->setInt(1, trainId);
-                res = pstmt->executeQuery();
-                
-                if (res->next()) {
-                    availableSeats = res->getInt("total_seats");
-                }
-            }
-            
-            delete pstmt;
-            delete res;
-            
-            return availableSeats;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return 0;
-        }
+    void clear() {
+        for (auto& entry : entries) delete entry.second.stmt;
+        entries.clear();
+        recency.clear();
     }
 };
 
-// ============= BOOKING CLASSES =============
-class Passenger {
+// A physical connection together with the statements prepared on it
+class CachedConnection {
 private:
-    int passengerId;
-    string passengerName;
-    int age;
-    string gender;
-    string seatNumber;
+    sql::Connection* con;
+    StatementCache statements;
 
 public:
-    Passenger() : passengerId(0), passengerName(""), age(0), gender(""), seatNumber("") {}
+    CachedConnection(sql::Connection* con, size_t cacheCapacity, StatementCacheCounters* counters)
+        : con(con), statements(cacheCapacity, counters) {}
     
-    Passenger(int id, string name, int age, string gender, string seat = "")
-        : passengerId(id), passengerName(name), age(age), gender(gender), seatNumber(seat) {}
+    ~CachedConnection() {
+        statements.clear();
+        delete con;
+    }
     
-    // Getters
-    int getPassengerId() const { return passengerId; }
-    string getPassengerName() const { return passengerName; }
-    int getAge() const { return age; }
-    string getGender() const { return gender; }
-    string getSeatNumber() const { return seatNumber; }
+    CachedConnection(const CachedConnection&) = delete;
+    CachedConnection& operator=(const CachedConnection&) = delete;
     
-    // Setters
-    void setPassengerId(int id) { passengerId = id; }
-    void setPassengerName(const string& name) { passengerName = name; }
-    void setAge(int a) { age = a; }
-    void setGender(const string& g) { gender = g; }
-    void setSeatNumber(const string& seat) { seatNumber = seat; }
+    sql::Connection* get() const { return con; }
     
-    void displayInfo() const {
-        cout << left << setw(5) << passengerId
-             << setw(25) << passengerName
-             << setw(5) << age
-             << setw(10) << gender
-             << setw(10) << seatNumber << endl;
+    PreparedStatementHandle prepare(const string& sql) {
+        return statements.prepare(con, sql);
     }
     
-    static void displayHeader() {
-        cout << left << setw(5) << "ID"
-             << setw(25) << "Name"
-             << setw(5) << "Age"
-             << setw(10) << "Gender"
-             << setw(10) << "Seat" << endl;
-        cout << string(55, '-') << endl;
+    // Swap in a freshly opened connection; statements prepared on the old one are dropped
+    void reset(sql::Connection* fresh) {
+        statements.clear();
+        delete con;
+        con = fresh;
     }
 };
 
-class Booking {
+class ConnectionPool;
+
+// Lease on a pooled connection; handed back to the pool when it goes out of scope
+class PooledConnection {
 private:
-    int bookingId;
-    int userId;
-    int trainId;
-    string bookingDate;
-    string journeyDate;
-    int numPassengers;
-    double totalFare;
-    string bookingStatus;
-    string paymentStatus;
-    vector<Passenger> passengers;
+    ConnectionPool* pool;
+    CachedConnection* con;
 
 public:
-    Booking() : bookingId(0), userId(0), trainId(0), bookingDate(""), journeyDate(""),
-                numPassengers(0), totalFare(0.0), bookingStatus(""), paymentStatus("") {}
+    PooledConnection() : pool(nullptr), con(nullptr) {}
+    PooledConnection(ConnectionPool* pool, CachedConnection* con) : pool(pool), con(con) {}
     
-    Booking(int bookId, int usrId, int trnId, string bookDate, string jrnyDate,
-            int numPass, double fare, string bookStatus, string payStatus)
-        : bookingId(bookId), userId(usrId), trainId(trnId), bookingDate(bookDate),
-          journeyDate(jrnyDate), numPassengers(numPass), totalFare(fare),
-          bookingStatus(bookStatus), paymentStatus(payStatus) {}
+    PooledConnection(PooledConnection&& other) : pool(other.pool), con(other.con) {
+        other.pool = nullptr;
+        other.con = nullptr;
+    }
     
-    // Getters
-    int getBookingId() const { return bookingId; }
-    int getUserId() const { return userId; }
-    int getTrainId() const { return trainId; }
-    string getBookingDate() const { return bookingDate; }
-    string getJourneyDate() const { return journeyDate; }
-    int getNumPassengers() const { return numPassengers; }
-    double getTotalFare() const { return totalFare; }
-    string getBookingStatus() const { return bookingStatus; }
-    string getPaymentStatus() const { return paymentStatus; }
-    vector<Passenger> getPassengers() const { return passengers; }
+    PooledConnection& operator=(PooledConnection&& other) {
+        if (this != &other) {
+            release();
+            pool = other.pool;
+            con = other.con;
+            other.pool = nullptr;
+            other.con = nullptr;
+        }
+        return *this;
+    }
     
-    // Setters
-    void setBookingId(int id) { bookingId = id; }
-    void setUserId(int id) { userId = id; }
-    void setTrainId(int id) { trainId = id; }
-    void setBookingDate(const string& date) { bookingDate = date; }
-    void setJourneyDate(const string& date) { journeyDate = date; }
-    void setNumPassengers(int num) { numPassengers = num; }
-    void setTotalFare(double fare) { totalFare = fare; }
-    void setBookingStatus(const string& status) { bookingStatus = status; }
-    void setPaymentStatus(const string& status) { paymentStatus = status; }
+    PooledConnection(const PooledConnection&) = delete;
+    PooledConnection& operator=(const PooledConnection&) = delete;
     
-    void addPassenger(const Passenger& passenger) {
-        passengers.push_back(passenger);
-    }
+    ~PooledConnection() { release(); }
     
-    void displayInfo(const Train& train) const {
-        cout << "\n====== Booking Details ======\n";
-        cout << "Booking ID: " << bookingId << endl;
-        cout << "Booking Date: " << bookingDate << endl;
-        cout << "Journey Date: " << journeyDate << endl;
-        cout << "Train: " << train.getTrainName() << " (" << train.getTrainNumber() << ")" << endl;
-        cout << "From: " << train.getSource() << " To: " << train.getDestination() << endl;
-        cout << "Departure: " << train.getDepartureTime() << " Arrival: " << train.getArrivalTime() << endl;
-        cout << "Number of Passengers: " << numPassengers << endl;
-        cout << "Total Fare: $" << fixed << setprecision(2) << totalFare << endl;
-        cout << "Booking Status: " << bookingStatus << endl;
-        cout << "Payment Status: " << paymentStatus << endl;
-        
-        cout << "\n------ Passenger Details ------\n";
-        Passenger::displayHeader();
-        for (const auto& passenger : passengers) {
-            passenger.displayInfo();
-        }
+    sql::Connection* get() const { return con ? con->get() : nullptr; }
+    sql::Connection* operator->() const { return get(); }
+    explicit operator bool() const { return con != nullptr; }
+    
+    // Prepare through the connection's statement cache
+    PreparedStatementHandle prepare(const string& sql) {
+        return con->prepare(sql);
     }
+    
+    void release();
 };
 
-class BookingManager {
+class ConnectionPool {
 private:
-    DatabaseConnector* dbConnector;
-    TrainManager* trainManager;
+    struct IdleConnection {
+        CachedConnection* con;
+        chrono::steady_clock::time_point lastUsed;
+    };
+    
+    sql::Driver* driver;
+    string server;
+    string username;
+    string password;
+    string schema;
+    size_t minSize;
+    size_t maxSize;
+    chrono::milliseconds acquireTimeout;
+    chrono::milliseconds validationInterval;
+    int maxConnectAttempts;
+    chrono::milliseconds initialBackoff;
+    size_t statementCacheCapacity;
+    
+    mutex mtx;
+    condition_variable available;
+    deque<IdleConnection> idle;
+    size_t totalConnections; // idle + leased + currently being opened
     
-    // Calculate fare based on distance, train type, etc.
-    double calculateFare(int trainId, int numPassengers) {
-        // Simple fare calculation (can be made more complex)
-        double baseFare = 50.0; // Base fare per passenger
-        return baseFare * numPassengers;
+    // Metrics
+    unsigned long long borrows;
+    unsigned long long timeouts;
+    unsigned long long reconnects;
+    unsigned long long discarded;
+    chrono::nanoseconds totalWait;
+    chrono::nanoseconds maxWait;
+    StatementCacheCounters statementCounters;
+    
+    // Open a new connection, retrying with exponential backoff
+    sql::Connection* openConnection() {
+        chrono::milliseconds backoff = initialBackoff;
+        
+        for (int attempt = 1; ; attempt++) {
+            try {
+                sql::Connection* con = driver->connect(server, username, password);
+                con->setSchema(schema);
+                return con;
+            } catch (sql::SQLException &e) {
+                if (attempt >= maxConnectAttempts) throw;
+                this_thread::sleep_for(backoff);
+                backoff = min(backoff * 2, chrono::milliseconds(2000));
+            }
+        }
+    }
+    
+    CachedConnection* newConnection() {
+        return new CachedConnection(openConnection(), statementCacheCapacity, &statementCounters);
     }
     
-    bool addPassengers(int bookingId, const vector<Passenger>& passengers) {
+    // Ping connections that sat idle for a while; replace them if the server dropped them
+    void validate(CachedConnection* con, chrono::steady_clock::time_point lastUsed) {
+        if (chrono::steady_clock::now() - lastUsed < validationInterval) {
+            return;
+        }
+        
         try {
-            sql::Connection* con = dbConnector->getConnection();
-            
-            for (const auto& passenger : passengers) {
-                sql::PreparedStatement* pstmt = con->prepareStatement(
-                    "INSERT INTO passengers(booking_id, passenger_name, age, gender, seat_number) VALUES(?, ?, ?, ?, ?)");
-                
-                pstmt->setInt(1, bookingId);
-                pstmt->setString(2, passenger.getPassengerName());
-                pstmt->setInt(3, passenger.getAge());
-                pstmt->setString(4, passenger.getGender());
-                pstmt->setString(5, passenger.getSeatNumber());
-                
-                pstmt->executeUpdate();
-                delete pstmt;
-            }
-            
-            return true;
+            if (!con->get()->isClosed() && con->get()->isValid()) return;
         } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return false;
+            // Fall through and reconnect
         }
+        
+        con->reset(openConnection());
+        
+        lock_guard<mutex> lock(mtx);
+        reconnects++;
     }
     
+    void recordWait(chrono::steady_clock::time_point start, bool timedOut = false) {
+        static OperationMetrics& waitMetrics = Metrics::poolWait();
+        chrono::nanoseconds waited = chrono::steady_clock::now() - start;
+        waitMetrics.record((uint64_t)waited.count(), timedOut);
+        if (timedOut) return;
+        
+        borrows++;
+        totalWait += waited;
+        if (waited > maxWait) maxWait = waited;
+    }
+
 public:
-    BookingManager(DatabaseConnector* connector, TrainManager* trainMgr) 
-        : dbConnector(connector), trainManager(trainMgr) {}
-    
-    bool createBooking(Booking& booking) {
+    ConnectionPool(sql::Driver* driver, const string& server, const string& username,
+                   const string& password, const string& schema,
+                   size_t minSize, size_t maxSize,
+                   chrono::milliseconds acquireTimeout = chrono::milliseconds(5000),
+                   chrono::milliseconds validationInterval = chrono::milliseconds(30000),
+                   int maxConnectAttempts = 5,
+                   chrono::milliseconds initialBackoff = chrono::milliseconds(100),
+                   size_t statementCacheCapacity = 64)
+        : driver(driver), server(server), username(username), password(password), schema(schema),
+          minSize(minSize), maxSize(max(maxSize, minSize)), acquireTimeout(acquireTimeout),
+          validationInterval(validationInterval), maxConnectAttempts(max(maxConnectAttempts, 1)),
+          initialBackoff(initialBackoff), statementCacheCapacity(statementCacheCapacity),
+          totalConnections(0), borrows(0), timeouts(0), reconnects(0), discarded(0),
+          totalWait(0), maxWait(0) {
         try {
-            // Check if seats are available
-            int availableSeats = trainManager->getAvailableSeats(booking.getTrainId(), booking.getJourneyDate());
-            
-            if (availableSeats < booking.getNumPassengers()) {
-                cout << "Sorry, only " << availableSeats << " seats are available for this train on the selected date.\n";
-                return false;
-            }
-            
-            // Calculate fare
-            double fare = calculateFare(booking.getTrainId(), booking.getNumPassengers());
-            booking.setTotalFare(fare);
-            
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "INSERT INTO bookings(user_id, train_id, booking_date, journey_date, num_passengers, total_fare, booking_status, payment_status) "
-                "VALUES(?, ?, ?, ?, ?, ?, ?, ?)");
-            
-            pstmt->setInt(1, booking.getUserId());
-            pstmt->setInt(2, booking.getTrainId());
-            pstmt->setString(3, booking.getBookingDate());
-            pstmt->setString(4, booking.getJourneyDate());
-            pstmt->setInt(5, booking.getNumPassengers());
-            pstmt->setDouble(6, booking.getTotalFare());
-            pstmt->setString(7, booking.getBookingStatus());
-            pstmt->setString(8, booking.getPaymentStatus());
-            
-            pstmt->executeUpdate();
-            
-            // Get the booking ID of the newly created booking
-            sql::Statement* stmt = con->createStatement();
-            sql::ResultSet* res = stmt->executeQuery("SELECT LAST_INSERT_ID() as id");
-            
-            if (res->next()) {
-                booking.setBookingId(res->getInt("id"));
+            for (size_t i = 0; i < minSize; i++) {
+                idle.push_back({newConnection(), chrono::steady_clock::now()});
+                totalConnections++;
             }
-            
-            delete pstmt;
-            delete stmt;
-            delete res;
-            
-            // Add passengers
-            addPassengers(booking.getBookingId(), booking.getPassengers());
-            
-            return true;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return false;
+        } catch (...) {
+            for (auto& entry : idle) delete entry.con;
+            throw;
         }
     }
     
-    bool cancelBooking(int bookingId) {
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "UPDATE bookings SET booking_status = 'Cancelled' WHERE booking_id = ?");
-            
-            pstmt->setInt(1, bookingId);
-            pstmt->executeUpdate();
-            delete pstmt;
-            
-            return true;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return false;
-        }
+    ~ConnectionPool() {
+        lock_guard<mutex> lock(mtx);
+        for (auto& entry : idle) delete entry.con;
+        idle.clear();
     }
     
-    bool updatePaymentStatus(int bookingId, const string& status) {
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "UPDATE bookings SET payment_status = ? WHERE booking_id = ?");
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+    
+    // Borrow a connection, blocking up to acquireTimeout when the pool is exhausted
+    PooledConnection acquire() {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        chrono::steady_clock::time_point deadline = start + acquireTimeout;
+        unique_lock<mutex> lock(mtx);
+        
+        while (true) {
+            if (!idle.empty()) {
+                // Most recently returned first, it is the least likely to have gone stale
+                IdleConnection entry = idle.back();
+                idle.pop_back();
+                recordWait(start);
+                lock.unlock();
+                
+                try {
+                    validate(entry.con, entry.lastUsed);
+                    return PooledConnection(this, entry.con);
+                } catch (...) {
+                    delete entry.con;
+                    lock.lock();
+                    totalConnections--;
+                    discarded++;
+                    available.notify_one();
+                    throw;
+                }
+            }
             
-            pstmt->setString(1, status);
-            pstmt->setInt(2, bookingId);
-            pstmt->executeUpdate();
-            delete pstmt;
+            if (totalConnections < maxSize) {
+                totalConnections++;
+                recordWait(start);
+                lock.unlock();
+                
+                try {
+                    return PooledConnection(this, newConnection());
+                } catch (...) {
+                    lock.lock();
+                    totalConnections--;
+                    available.notify_one();
+                    throw;
+                }
+            }
             
-            return true;
-        } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return false;
+            if (available.wait_until(lock, deadline) == cv_status::timeout &&
+                idle.empty() && totalConnections >= maxSize) {
+                timeouts++;
+                recordWait(start, true);
+                throw sql::SQLException("Timed out waiting for a free database connection");
+            }
         }
     }
     
-    vector<Booking> getUserBookings(int userId) {
-        vector<Booking> bookings;
+    void release(CachedConnection* con) {
+        bool healthy = true;
         
         try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "SELECT * FROM bookings WHERE user_id = ? ORDER BY booking_date DESC");
-            
-            pstmt->setInt(1, userId);
-            sql::ResultSet* res = pstmt->executeQuery();
+            if (con->get()->isClosed()) {
+                healthy = false;
+            } else if (!con->get()->getAutoCommit()) {
+                // A transaction abandoned by an error path must not leak into the next lease
+                con->get()->rollback();
+                con->get()->setAutoCommit(true);
+            }
+        } catch (sql::SQLException &e) {
+            healthy = false;
+        }
+        
+        {
+            lock_guard<mutex> lock(mtx);
             
-            while (res->next()) {
-                Booking booking(
-                    res->getInt("booking_id"),
-                    res->getInt("user_id"),
-                    res->getInt("train_id"),
-                    res->getString("booking_date"),
-                    res->getString("journey_date"),
-                    res->getInt("num_passengers"),
-                    res->getDouble("total_fare"),
-                    res->getString("booking_status"),
-                    res->getString("payment_status")
-                );
-                
-                // Get passengers for this booking
-                sql::PreparedStatement* pstmt2 = con->prepareStatement(
-                    "SELECT * FROM passengers WHERE booking_id = ?");
-                
-                pstmt2->setInt(1, booking.getBookingId());
-                sql::ResultSet* passengerRes = pstmt2->executeQuery();
-                
-                while (passengerRes->next()) {
-                    Passenger passenger(
-                        passengerRes->getInt("passenger_id"),
-                        passengerRes->getString("passenger_name"),
-                        passengerRes->getInt("age"),
-                        passengerRes->getString("gender"),
-                        passengerRes->getString("seat_number")
-                    );
-                    
-                    booking.addPassenger(passenger);
-                }
-                
-                delete pstmt2;
-                delete passengerRes;
-                
-                bookings.push_back(booking);
+            if (!healthy) {
+                delete con;
+                totalConnections--;
+                discarded++;
+            } else {
+                idle.push_back({con, chrono::steady_clock::now()});
+            }
+        }
+        available.notify_one();
+    }
+    
+    PoolStats getStats() {
+        lock_guard<mutex> lock(mtx);
+        
+        PoolStats stats;
+        stats.totalConnections = totalConnections;
+        stats.idleConnections = idle.size();
+        stats.inUseConnections = totalConnections - idle.size();
+        stats.borrows = borrows;
+        stats.timeouts = timeouts;
+        stats.reconnects = reconnects;
+        stats.discarded = discarded;
+        stats.avgWaitMs = borrows ? chrono::duration<double, milli>(totalWait).count() / borrows : 0.0;
+        stats.maxWaitMs = chrono::duration<double, milli>(maxWait).count();
+        stats.statementCacheHits = statementCounters.hits;
+        stats.statementCacheMisses = statementCounters.misses;
+        stats.statementCacheEvictions = statementCounters.evictions;
+        return stats;
+    }
+};
+
+void PooledConnection::release() {
+    if (pool && con) {
+        pool->release(con);
+    }
+    pool = nullptr;
+    con = nullptr;
+}
+
+// Read-only replica of the primary and the replication lag last measured on it
+struct ReplicaEndpoint {
+    string server;
+    ConnectionPool pool;
+    atomic<int> lagSeconds; // -1 while unreachable or not replicating
+    
+    // Only the monitor thread uses these
+    bool legacyStatus; // Answered SHOW SLAVE STATUS rather than SHOW REPLICA STATUS last time
+    bool lagUnmeasured; // Already reported that its lag cannot be measured
+    
+    // Opens connections on first use, and gives up on the first failed attempt so a
+    // replica that is down costs a read one connect, not a round of retries
+    ReplicaEndpoint(sql::Driver* driver, const string& server, const string& username, const string& password,
+                    const string& schema, size_t maxSize)
+        : server(server), pool(driver, server, username, password, schema, 0, maxSize,
+                               chrono::milliseconds(5000), chrono::milliseconds(30000), 1),
+          lagSeconds(-1), legacyStatus(false), lagUnmeasured(false) {}
+};
+
+class DatabaseConnector {
+private:
+    sql::Driver* driver;
+    ConnectionPool* pool;
+    const string server = "tcp://127.0.0.1:3306";
+    const string username = "root";
+    const string password = "password"; // Change to your MySQL password
+    const string schema = "railway_booking_system";
+    const size_t poolMinSize = 2;
+    const size_t poolMaxSize = 16;
+    
+    // Read replicas, e.g. { "tcp://10.0.0.2:3306" }; empty sends every read to the primary
+    const vector<string> replicaServers = {};
+    const size_t replicaPoolMaxSize = 16;
+    const int maxReplicaLagSeconds = 5;
+    const chrono::milliseconds replicaCheckInterval = chrono::milliseconds(1000);
+    
+    vector<unique_ptr<ReplicaEndpoint>> replicas;
+    atomic<size_t> nextReplica;
+    
+    // When each user last wrote, kept until any usable replica must have the write
+    mutex writesMutex;
+    unordered_map<int, chrono::steady_clock::time_point> lastWriteByUser;
+    
+    mutex monitorMutex;
+    condition_variable monitorWake;
+    bool stopping;
+    thread monitor;
+    
+    // Longest a write can take to show on a replica that is still within maxReplicaLagSeconds;
+    // lag is reported in whole seconds and was measured up to one check interval ago
+    chrono::steady_clock::duration visibilityDelay(int lagSeconds) const {
+        return chrono::seconds(lagSeconds + 1) + replicaCheckInterval;
+    }
+    
+    // SHOW REPLICA STATUS needs MySQL 8.0.22, so an older server is asked with SHOW SLAVE
+    // STATUS instead; whichever answered last is tried first. Reports once, until the lag
+    // can be measured again, that a replica is left out of reads.
+    static int measureLag(ReplicaEndpoint& replica) {
+        string problem;
+        try {
+            PooledConnection con = replica.pool.acquire();
+            unique_ptr<sql::Statement> stmt(con->createStatement());
+            unique_ptr<sql::ResultSet> res;
+            try {
+                res.reset(stmt->executeQuery(replica.legacyStatus ? "SHOW SLAVE STATUS" : "SHOW REPLICA STATUS"));
+            } catch (sql::SQLException&) {
+                replica.legacyStatus = !replica.legacyStatus;
+                res.reset(stmt->executeQuery(replica.legacyStatus ? "SHOW SLAVE STATUS" : "SHOW REPLICA STATUS"));
             }
+            const char* column = replica.legacyStatus ? "Seconds_Behind_Master" : "Seconds_Behind_Source";
             
-            delete pstmt;
-            delete res;
+            // No row: not a replica; NULL: replication is stopped
+            if (!res->next()) {
+                problem = "not a replica";
+            } else if (res->isNull(column)) {
+                problem = "replication is stopped";
+            } else {
+                replica.lagUnmeasured = false;
+                return res->getInt(column);
+            }
         } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
+            problem = e.what();
         }
         
-        return bookings;
+        if (!replica.lagUnmeasured) {
+            replica.lagUnmeasured = true;
+            cerr << "Replica " << replica.server << ": cannot measure replication lag (" << problem
+                 << "), leaving it out of reads\n";
+        }
+        return -1;
     }
     
-    Booking* getBookingById(int bookingId) {
-        try {
-            sql::Connection* con = dbConnector->getConnection();
-            sql::PreparedStatement* pstmt = con->prepareStatement(
-                "SELECT * FROM bookings WHERE booking_id = ?");
+    void monitorReplicas() {
+        unique_lock<mutex> lock(monitorMutex);
+        while (!stopping) {
+            lock.unlock();
             
-            pstmt->setInt(1, bookingId);
-            sql::ResultSet* res = pstmt->executeQuery();
+            for (auto& replica : replicas) {
+                replica->lagSeconds = measureLag(*replica);
+            }
             
-            if (res->next()) {
-                Booking* booking = new Booking(
-                    res->getInt("booking_id"),
-                    res->getInt("user_id"),
-                    res->getInt("train_id"),
-                    res->getString("booking_date"),
-                    res->getString("journey_date"),
-                    res->getInt("num_passengers"),
-                    res->getDouble("total_fare"),
-                    res->getString("booking_status"),
-                    res->getString("payment_status")
-                );
-                
-                // Get passengers for this booking
-                sql::PreparedStatement* pstmt2 = con->prepareStatement(
-                    "SELECT * FROM passengers WHERE booking_id = ?");
-                
-                pstmt2->setInt(1, booking->getBookingId());
-                sql::ResultSet* passengerRes = pstmt2->executeQuery();
-                
-                while (passengerRes->next()) {
-                    Passenger passenger(
-                        passengerRes->getInt("passenger_id"),
-                        passengerRes->getString("passenger_name"),
-                        passengerRes->getInt("age"),
-                        passengerRes->getString("gender"),
-                        passengerRes->getString("seat_number")
-                    );
-                    
-                    booking->addPassenger(passenger);
+            {
+                lock_guard<mutex> writesLock(writesMutex);
+                chrono::steady_clock::time_point expired = chrono::steady_clock::now() - visibilityDelay(maxReplicaLagSeconds);
+                for (auto it = lastWriteByUser.begin(); it != lastWriteByUser.end(); ) {
+                    if (it->second < expired) it = lastWriteByUser.erase(it);
+                    else ++it;
                 }
-                
-                delete pstmt2;
-                delete passengerRes;
-                delete pstmt;
-                delete res;
-                
-                return booking;
             }
             
-            delete pstmt;
-            delete res;
+            lock.lock();
+            monitorWake.wait_for(lock, replicaCheckInterval, [this] { return stopping; });
+        }
+    }
+    
+    chrono::steady_clock::duration sinceLastWrite(int userId) {
+        if (userId > 0) {
+            lock_guard<mutex> lock(writesMutex);
+            auto it = lastWriteByUser.find(userId);
+            if (it != lastWriteByUser.end()) return chrono::steady_clock::now() - it->second;
+        }
+        return chrono::steady_clock::duration::max();
+    }
+
+public:
+    DatabaseConnector() : pool(nullptr), nextReplica(0), stopping(false) {
+        try {
+            driver = get_driver_instance();
+            pool = new ConnectionPool(driver, server, username, password, schema, poolMinSize, poolMaxSize);
+            cout << "Database connection established successfully.\n";
             
-            return nullptr;
+            for (const auto& replicaServer : replicaServers) {
+                replicas.push_back(unique_ptr<ReplicaEndpoint>(new ReplicaEndpoint(
+                    driver, replicaServer, username, password, schema, replicaPoolMaxSize)));
+            }
+            if (!replicas.empty()) {
+                monitor = thread(&DatabaseConnector::monitorReplicas, this);
+            }
         } catch (sql::SQLException &e) {
-            cout << "SQL Error: " << e.what() << endl;
-            return nullptr;
+            // The destructor does not run for a half-built connector
+            delete pool;
+            throw runtime_error(string("Cannot connect to the database: ") + e.what() +
+                                " (MySQL error code: " + to_string(e.getErrorCode()) +
+                                ", SQLState: " + e.getSQLState() + ")");
         }
     }
-};
-
-// ============= PAYMENT SYSTEM =============
-class PaymentSystem {
-private:
-    DatabaseConnector* dbConnector;
-    BookingManager* bookingManager;
     
-public:
-    PaymentSystem(DatabaseConnector* connector, BookingManager* bookingMgr)
-        : dbConnector(connector), bookingManager(bookingMgr) {}
+    ~DatabaseConnector() {
+        {
+            lock_guard<mutex> lock(monitorMutex);
+            stopping = true;
+        }
+        monitorWake.notify_one();
+        if (monitor.joinable()) monitor.join();
+        
+        replicas.clear();
+        delete pool;
+    }
     
-    bool processPayment(int bookingId, const string& paymentMethod) {
-        // Simulate payment processing
-        cout << "Processing payment for booking #" << bookingId << " using " << paymentMethod << "...\n";
+    // Borrow a connection from the pool; it is returned when the lease goes out of scope
+    PooledConnection getConnection() {
+        return pool->acquire();
+    }
+    
+    // Connection for a read that can tolerate replication lag, from the replicas in turn.
+    // A replica is skipped while it lags more than maxReplicaLagSeconds, and, for a read on
+    // behalf of userId, until it must have that user's last write. With no replica left,
+    // or one failing to connect, the read goes to the primary.
+    PooledConnection getReadConnection(int userId = 0) {
+        static atomic<uint64_t>& replicaReads = Metrics::readRoutes("replica");
+        static atomic<uint64_t>& primaryReads = Metrics::readRoutes("primary");
         
-        // In a real system, we would integrate with payment gateways
-        // For simulation, we'll just update the payment status
-        if (bookingManager->updatePaymentStatus(bookingId, "Paid")) {
-            cout << "Payment successful!\n";
-            return true;
-        } else {
-            cout << "Payment failed. Please try again.\n";
-            return false;
+        if (!replicas.empty()) {
+            chrono::steady_clock::duration sinceWrite = sinceLastWrite(userId);
+            size_t first = nextReplica.fetch_add(1, memory_order_relaxed);
+            
+            for (size_t i = 0; i < replicas.size(); i++) {
+                ReplicaEndpoint& replica = *replicas[(first + i) % replicas.size()];
+                int lag = replica.lagSeconds.load(memory_order_relaxed);
+                if (lag < 0 || lag > maxReplicaLagSeconds || sinceWrite <= visibilityDelay(lag)) {
+                    continue;
+                }
+                
+                try {
+                    PooledConnection con = replica.pool.acquire();
+                    replicaReads.fetch_add(1, memory_order_relaxed);
+                    return con;
+                } catch (sql::SQLException &e) {
+                    replica.lagSeconds = -1; // Skipped until the monitor reaches it again
+                }
+            }
         }
+        
+        primaryReads.fetch_add(1, memory_order_relaxed);
+        return pool->acquire();
     }
     
-    void displayPaymentOptions() {
-        cout << "\n------ Payment Options ------\n";
-        cout << "1. Credit Card\n";
-        cout << "2. Debit Card\n";
-        cout << "3. Net Banking\n";
-        cout << "4. UPI Payment\n";
-        cout << "5. Cancel Payment\n";
+    // Record a write made for a user, so their next reads see it
+    void noteWrite(int userId) {
+        if (replicas.empty() || userId <= 0) return;
+        
+        lock_guard<mutex> lock(writesMutex);
+        lastWriteByUser[userId] = chrono::steady_clock::now();
+    }
+    
+    bool hasReplicas() const {
+        return !replicas.empty();
+    }
+    
+    PoolStats getPoolStats() {
+        return pool->getStats();
+    }
+    
+    size_t getPoolMaxSize() const {
+        return poolMaxSize;
     }
 };
 
-// ============= MENU SYSTEM =============
-class Menu {
+// ============= BASE CLASSES =============
+class Person {
+protected:
+    string name;
+    string email;
+    string phone;
+
+public:
+    Person() : name(""), email(""), phone("") {}
+    Person(string name, string email, string phone) 
+        : name(name), email(email), phone(phone) {}
+    
+    virtual ~Person() {}
+    
+    // Getters
+    string getName() const { return name; }
+    string getEmail() const { return email; }
+    string getPhone() const { return phone; }
+    
+    // Setters
+    void setName(const string& name) { this->name = name; }
+    void setEmail(const string& email) { this->email = email; }
+    void setPhone(const string& phone) { this->phone = phone; }
+    
+    virtual void displayInfo() const = 0; // Pure virtual function
+};
+
+// ============= USER CLASSES =============
+class User : public Person {
 private:
-    DatabaseConnector* dbConnector;
-    UserManager* userManager;
-    TrainManager* trainManager;
-    BookingManager* bookingManager;
-    PaymentSystem* paymentSystem;
-    User* currentUser;
+    int userId;
+    string username;
+    string password;
+    string registrationDate;
+
+public:
+    User() : Person(), userId(0), username(""), password(""), registrationDate("") {}
     
-    void displayMainMenu() const {
-        Utility::clearScreen();
-        cout << "\n===== RAILWAY TICKET BOOKING SYSTEM =====\n";
-        cout << "1. Login\n";
-        cout << "2. Register\n";
-        cout << "3. Exit\n";
-        cout << "Choose an option: ";
+    User(int userId, string username, string password, string name, string email, string phone, string regDate)
+        : Person(name, email, phone), userId(userId), username(username), password(password), registrationDate(regDate) {}
+    
+    // Getters
+    int getUserId() const { return userId; }
+    string getUsername() const { return username; }
+    string getPassword() const { return password; }
+    string getRegistrationDate() const { return registrationDate; }
+    
+    // Setters
+    void setUserId(int id) { userId = id; }
+    void setUsername(const string& uname) { username = uname; }
+    void setPassword(const string& pwd) { password = pwd; }
+    void setRegistrationDate(const string& date) { registrationDate = date; }
+    
+    void displayInfo() const override {
+        cout << "User ID: " << userId << endl;
+        cout << "Username: " << username << endl;
+        cout << "Name: " << name << endl;
+        cout << "Email: " << email << endl;
+        cout << "Phone: " << phone << endl;
+        cout << "Registration Date: " << registrationDate << endl;
     }
+};
+
+// Storage operations behind UserManager; see STORAGE BACKENDS for implementations
+class UserRepository {
+public:
+    virtual ~UserRepository() {}
     
-    void displayUserMenu() const {
-        Utility::clearScreen();
-        cout << "\n===== Welcome, " << currentUser->getName() << "! =====\n";
-        cout << "1. Search Trains\n";
-        cout << "2. View All Trains\n";
-        cout << "3. Book Ticket\n";
-        cout << "4. View My Bookings\n";
-        cout << "5. Cancel Booking\n";
-        cout << "6. Update Profile\n";
-        cout << "7. Change Password\n";
-        cout << "8. Logout\n";
-        cout << "Choose an option: ";
+    virtual void insertUser(User& user) = 0; // Sets the generated user ID
+    virtual User* findUserByCredentials(const string& username, const string& password) = 0;
+    virtual void updateUser(const User& user) = 0;
+    virtual void updatePassword(int userId, const string& newPassword) = 0;
+};
+
+// Opaque bearer tokens for logged-in users. Tokens live in a sharded hash map, so
+// checking one is a hash lookup under one shard's lock, with no storage access. A token
+// expires after idleTimeout without use. Each shard tracks deadlines on a timer wheel:
+// slot tick % slotCount lists the tokens due in that tick, and only the slots that
+// have come due are swept. Using a token just moves its deadline; the sweep that
+// reaches it early files it again under the new one.
+class SessionStore {
+private:
+    static const size_t slotCount = 256;
+    
+    struct Session {
+        shared_ptr<const User> user;
+        uint64_t expiresAt; // Tick
+    };
+    
+    struct Shard {
+        mutex mtx;
+        unordered_map<string, Session> sessions;
+        vector<string> wheel[slotCount];
+        uint64_t sweptTo; // Every tick up to this one has been swept
+        
+        Shard() : sweptTo(0) {}
+    };
+    
+    chrono::steady_clock::time_point epoch;
+    chrono::steady_clock::duration tickLength;
+    uint64_t idleTicks;
+    vector<unique_ptr<Shard>> shards;
+    
+    uint64_t currentTick() const {
+        return (uint64_t)((chrono::steady_clock::now() - epoch) / tickLength);
+    }
+    
+    Shard& shardFor(const string& token) {
+        return *shards[hash<string>()(token) % shards.size()];
+    }
+    
+    static void sweepSlot(Shard& shard, size_t slot, uint64_t tick) {
+        vector<string>& due = shard.wheel[slot];
+        size_t kept = 0;
+        
+        for (size_t i = 0; i < due.size(); i++) {
+            auto it = shard.sessions.find(due[i]);
+            if (it == shard.sessions.end()) continue; // Revoked
+            
+            if (it->second.expiresAt <= tick) {
+                shard.sessions.erase(it);
+            } else if (it->second.expiresAt % slotCount == slot) {
+                due[kept++].swap(due[i]);
+            } else {
+                shard.wheel[it->second.expiresAt % slotCount].push_back(due[i]);
+            }
+        }
+        due.resize(kept);
+    }
+    
+    // Sweep the slots due since the last call; after a long pause each slot is swept once
+    static void advance(Shard& shard, uint64_t tick) {
+        if (tick <= shard.sweptTo) {
+            return;
+        }
+        
+        uint64_t from = max(shard.sweptTo + 1, tick >= slotCount ? tick - slotCount + 1 : 0);
+        for (uint64_t t = from; t <= tick; t++) {
+            sweepSlot(shard, t % slotCount, tick);
+        }
+        shard.sweptTo = tick;
+    }
+    
+
+public:
+    SessionStore(chrono::seconds idleTimeout = chrono::seconds(30 * 60), size_t shardCount = 64,
+                 chrono::milliseconds tick = chrono::milliseconds(1000))
+        : epoch(chrono::steady_clock::now()), tickLength(tick),
+          idleTicks(max<uint64_t>((uint64_t)(idleTimeout / tick), 1)) {
+        for (size_t i = 0; i < max<size_t>(shardCount, 1); i++) {
+            shards.push_back(unique_ptr<Shard>(new Shard()));
+        }
+    }
+    
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+    
+    string create(const User& user) {
+        string token = Utility::randomKey();
+        Shard& shard = shardFor(token);
+        uint64_t tick = currentTick();
+        
+        lock_guard<mutex> lock(shard.mtx);
+        advance(shard, tick);
+        
+        Session& session = shard.sessions[token];
+        session.user = make_shared<const User>(user);
+        session.expiresAt = tick + idleTicks;
+        shard.wheel[session.expiresAt % slotCount].push_back(token);
+        return token;
+    }
+    
+    // The token's user, pushing its expiry back; null if the token is unknown or expired
+    shared_ptr<const User> find(const string& token) {
+        Shard& shard = shardFor(token);
+        uint64_t tick = currentTick();
+        
+        lock_guard<mutex> lock(shard.mtx);
+        advance(shard, tick);
+        
+        auto it = shard.sessions.find(token);
+        if (it == shard.sessions.end()) {
+            return nullptr;
+        }
+        
+        it->second.expiresAt = tick + idleTicks;
+        return it->second.user;
+    }
+    
+    bool revoke(const string& token) {
+        Shard& shard = shardFor(token);
+        
+        lock_guard<mutex> lock(shard.mtx);
+        return shard.sessions.erase(token) > 0;
+    }
+    
+    size_t size() {
+        size_t total = 0;
+        for (auto& shard : shards) {
+            lock_guard<mutex> lock(shard->mtx);
+            advance(*shard, currentTick());
+            total += shard->sessions.size();
+        }
+        return total;
+    }
+};
+
+class UserManager {
+private:
+    UserRepository* userRepository;
+    SessionStore sessions;
+
+public:
+    UserManager(UserRepository* repository) : userRepository(repository) {}
+    
+    bool registerUser(User& user) {
+        static OperationMetrics& metrics = Metrics::operation("registerUser");
+        OperationTimer timer(metrics);
+        
+        try {
+            userRepository->insertUser(user);
+            return true;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return false;
+        }
+    }
+    
+    User* loginUser(const string& username, const string& password) {
+        static OperationMetrics& metrics = Metrics::operation("loginUser");
+        OperationTimer timer(metrics);
+        
+        try {
+            return userRepository->findUserByCredentials(username, password);
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return nullptr;
+        }
+    }
+    
+    // Token for a user who has just logged in, to authenticate their later requests
+    string startSession(const User& user) {
+        return sessions.create(user);
+    }
+    
+    // Null if the token is unknown or has expired; no database access either way
+    shared_ptr<const User> authenticate(const string& token) {
+        static OperationMetrics& metrics = Metrics::operation("authenticate");
+        OperationTimer timer(metrics);
+        
+        shared_ptr<const User> user = sessions.find(token);
+        if (!user) timer.fail();
+        return user;
+    }
+    
+    void endSession(const string& token) {
+        sessions.revoke(token);
+    }
+    
+    size_t activeSessionCount() {
+        return sessions.size();
+    }
+    
+    bool updateUserProfile(const User& user) {
+        static OperationMetrics& metrics = Metrics::operation("updateUserProfile");
+        OperationTimer timer(metrics);
+        
+        try {
+            userRepository->updateUser(user);
+            return true;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return false;
+        }
+    }
+    
+    bool changePassword(int userId, const string& newPassword) {
+        static OperationMetrics& metrics = Metrics::operation("changePassword");
+        OperationTimer timer(metrics);
+        
+        try {
+            userRepository->updatePassword(userId, newPassword);
+            return true;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return false;
+        }
+    }
+};
+
+// ============= SEAT INVENTORY =============
+// Hash map split into independently locked stripes so lookups for different
+// (train, date) keys do not contend on one mutex. Entries are never erased,
+// so returned pointers stay valid for the life of the map.
+template <typename T>
+class StripedMap {
+private:
+    static const size_t stripeCount = 64;
+    
+    struct Stripe {
+        mutex mtx;
+        unordered_map<string, unique_ptr<T>> entries;
+    };
+    
+    Stripe stripes[stripeCount];
+    
+    Stripe& stripeFor(const string& key) {
+        return stripes[hash<string>()(key) % stripeCount];
+    }
+
+public:
+    T* find(const string& key) {
+        Stripe& stripe = stripeFor(key);
+        lock_guard<mutex> lock(stripe.mtx);
+        auto it = stripe.entries.find(key);
+        return it != stripe.entries.end() ? it->second.get() : nullptr;
+    }
+    
+    // Keep the existing entry if another thread inserted one first
+    T* insertIfAbsent(const string& key, unique_ptr<T> value) {
+        Stripe& stripe = stripeFor(key);
+        lock_guard<mutex> lock(stripe.mtx);
+        unique_ptr<T>& slot = stripe.entries[key];
+        if (!slot) slot = move(value);
+        return slot.get();
+    }
+};
+
+// Free seats on each segment of a route, where segment i runs from stop i to stop i + 1.
+// A segment tree with lazy range adds, so the free seats over a stretch of stops (the
+// minimum over its segments) and taking seats along it are both O(log segments).
+// Ranges are [fromStop, toStop) over segments; a negative toStop means the final stop.
+class SegmentSeats {
+private:
+    int segments;
+    vector<int> minFree; // Per node: minimum over its range, including its own pending add
+    vector<int> added;   // Per node: added to its whole range but not to its children
+    
+    void build(int node, int lo, int hi, const vector<int>& freeBySegment) {
+        if (hi - lo == 1) {
+            minFree[node] = freeBySegment[lo];
+            return;
+        }
+        
+        int mid = (lo + hi) / 2;
+        build(2 * node, lo, mid, freeBySegment);
+        build(2 * node + 1, mid, hi, freeBySegment);
+        minFree[node] = min(minFree[2 * node], minFree[2 * node + 1]);
+    }
+    
+    void add(int node, int lo, int hi, int from, int to, int delta) {
+        if (to <= lo || hi <= from) return;
+        
+        if (from <= lo && hi <= to) {
+            minFree[node] += delta;
+            added[node] += delta;
+            return;
+        }
+        
+        int mid = (lo + hi) / 2;
+        add(2 * node, lo, mid, from, to, delta);
+        add(2 * node + 1, mid, hi, from, to, delta);
+        minFree[node] = min(minFree[2 * node], minFree[2 * node + 1]) + added[node];
+    }
+    
+    int query(int node, int lo, int hi, int from, int to) const {
+        if (to <= lo || hi <= from) return INT_MAX;
+        if (from <= lo && hi <= to) return minFree[node];
+        
+        int mid = (lo + hi) / 2;
+        int below = min(query(2 * node, lo, mid, from, to), query(2 * node + 1, mid, hi, from, to));
+        return below == INT_MAX ? below : below + added[node];
+    }
+    
+    // False for an empty or out-of-route range
+    bool resolve(int fromStop, int& toStop) const {
+        if (toStop < 0) toStop = segments;
+        return fromStop >= 0 && fromStop < toStop && toStop <= segments;
+    }
+
+public:
+    SegmentSeats(const vector<int>& freeBySegment)
+        : segments(max((int)freeBySegment.size(), 1)), minFree(4 * segments, 0), added(4 * segments, 0) {
+        build(1, 0, segments, freeBySegment.empty() ? vector<int>(1, 0) : freeBySegment);
+    }
+    
+    int segmentCount() const { return segments; }
+    
+    // Seats free on every segment from fromStop to toStop; 0 for an invalid range
+    int available(int fromStop, int toStop) const {
+        if (!resolve(fromStop, toStop)) return 0;
+        return query(1, 0, segments, fromStop, toStop);
+    }
+    
+    // Take numSeats along the range only if they are free on all of it
+    bool tryTake(int fromStop, int toStop, int numSeats) {
+        if (!resolve(fromStop, toStop) || query(1, 0, segments, fromStop, toStop) < numSeats) {
+            return false;
+        }
+        add(1, 0, segments, fromStop, toStop, -numSeats);
+        return true;
+    }
+    
+    // Return numSeats along the range, never leaving a segment with more than capacity free
+    void give(int fromStop, int toStop, int numSeats, int capacity) {
+        if (!resolve(fromStop, toStop)) return;
+        
+        for (int segment = fromStop; segment < toStop; segment++) {
+            int room = capacity - query(1, 0, segments, segment, segment + 1);
+            if (room > 0) {
+                add(1, 0, segments, segment, segment + 1, min(numSeats, room));
+            }
+        }
+    }
+};
+
+// Remaining seats per (train, journey date) and route segment, loaded lazily from the
+// bookings table
+class SeatInventory {
+public:
+    struct Entry {
+        mutex mtx; // Guards seats
+        SegmentSeats seats;
+        atomic<unsigned long long> version; // Bumped on every reserve/release
+        mutex reconcileMutex;
+        chrono::steady_clock::time_point loadedAt;
+        
+        Entry(const vector<int>& freeBySegment)
+            : seats(freeBySegment), version(0), loadedAt(chrono::steady_clock::now()) {}
+    };
+
+private:
+    StripedMap<Entry> entries;
+    chrono::milliseconds reconcileInterval;
+
+public:
+    static string makeKey(int trainId, const string& journeyDate) {
+        return to_string(trainId) + "|" + Utility::normalizeDate(journeyDate);
+    }
+    
+    SeatInventory(chrono::milliseconds reconcileInterval = chrono::milliseconds(60000))
+        : reconcileInterval(reconcileInterval) {}
+    
+    SeatInventory(const SeatInventory&) = delete;
+    SeatInventory& operator=(const SeatInventory&) = delete;
+    
+    Entry* find(int trainId, const string& journeyDate) {
+        return entries.find(makeKey(trainId, journeyDate));
+    }
+    
+    // Insert the counts read from the database; a concurrent loader that won the race is kept
+    Entry* load(int trainId, const string& journeyDate, const vector<int>& freeBySegment) {
+        return entries.insertIfAbsent(makeKey(trainId, journeyDate), unique_ptr<Entry>(new Entry(freeBySegment)));
+    }
+    
+    bool isStale(Entry* entry) {
+        lock_guard<mutex> lock(entry->reconcileMutex);
+        return chrono::steady_clock::now() - entry->loadedAt >= reconcileInterval;
+    }
+    
+    // Overwrite with fresh database counts, unless this process changed the entry meanwhile
+    void reconcile(Entry* entry, unsigned long long seenVersion, const vector<int>& freeBySegment) {
+        lock_guard<mutex> lock(entry->reconcileMutex);
+        {
+            lock_guard<mutex> seatsLock(entry->mtx);
+            if (entry->version.load() == seenVersion) {
+                entry->seats = SegmentSeats(freeBySegment);
+            }
+        }
+        entry->loadedAt = chrono::steady_clock::now();
+    }
+    
+    int available(Entry* entry, int fromStop, int toStop) {
+        lock_guard<mutex> lock(entry->mtx);
+        return entry->seats.available(fromStop, toStop);
+    }
+    
+    // Take numSeats from fromStop to toStop only if that many are still free on every segment
+    bool tryReserve(Entry* entry, int numSeats, int fromStop, int toStop) {
+        lock_guard<mutex> lock(entry->mtx);
+        if (!entry->seats.tryTake(fromStop, toStop, numSeats)) {
+            return false;
+        }
+        entry->version++;
+        return true;
+    }
+    
+    // Give back seats the database no longer counts as taken. A stale entry is reloaded
+    // instead, since counts read from the database after that write already include them.
+    void release(Entry* entry, int numSeats, int fromStop, int toStop, int capacity) {
+        lock_guard<mutex> lock(entry->reconcileMutex);
+        if (chrono::steady_clock::now() - entry->loadedAt >= reconcileInterval) {
+            entry->loadedAt = chrono::steady_clock::time_point();
+            return;
+        }
+        
+        lock_guard<mutex> seatsLock(entry->mtx);
+        entry->seats.give(fromStop, toStop, numSeats, capacity);
+        entry->version++;
+    }
+    
+    // Force the next lookup to reload from the database
+    void invalidate(int trainId, const string& journeyDate) {
+        Entry* entry = find(trainId, journeyDate);
+        if (entry) {
+            lock_guard<mutex> lock(entry->reconcileMutex);
+            entry->loadedAt = chrono::steady_clock::time_point();
+        }
+    }
+};
+
+// ============= SEAT ALLOCATION =============
+// Occupied seats of one train on one date, one bit per seat for each route segment, so a
+// seat left at an intermediate stop can be sold again for the rest of the route. Ranges
+// are [fromStop, toStop) over segments as in SegmentSeats.
+class SeatMap {
+private:
+    vector<uint64_t> words; // Segment-major: segment s owns wordsPerSegment words from s * wordsPerSegment
+    int totalSeats;
+    int segments;
+    size_t wordsPerSegment;
+    
+    static int countTrailingZeros(uint64_t value) {
+        #ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return (int)index;
+        #else
+            return __builtin_ctzll(value);
+        #endif
+    }
+    
+    void set(int segment, int seat) { words[segment * wordsPerSegment + (seat >> 6)] |= (uint64_t(1) << (seat & 63)); }
+    void clear(int segment, int seat) { words[segment * wordsPerSegment + (seat >> 6)] &= ~(uint64_t(1) << (seat & 63)); }
+    
+    // False for an empty or out-of-route range
+    bool resolve(int fromStop, int& toStop) const {
+        if (toStop < 0) toStop = segments;
+        return fromStop >= 0 && fromStop < toStop && toStop <= segments;
+    }
+    
+    // Seats taken on any segment of the range
+    vector<uint64_t> takenAlong(int fromStop, int toStop) const {
+        vector<uint64_t> taken(words.begin() + fromStop * wordsPerSegment,
+                               words.begin() + (fromStop + 1) * wordsPerSegment);
+        for (int segment = fromStop + 1; segment < toStop; segment++) {
+            const uint64_t* row = &words[segment * wordsPerSegment];
+            for (size_t w = 0; w < wordsPerSegment; w++) taken[w] |= row[w];
+        }
+        return taken;
+    }
+    
+    // First seat in [from, to) with the given state, scanning a whole word at a time; to if none
+    static int nextWithState(const vector<uint64_t>& taken, int from, int to, bool used) {
+        if (from >= to) return to;
+        
+        size_t w = from >> 6;
+        uint64_t bits = (used ? taken[w] : ~taken[w]) & (~uint64_t(0) << (from & 63));
+        
+        while (bits == 0) {
+            w++;
+            if ((int)(w << 6) >= to) return to;
+            bits = used ? taken[w] : ~taken[w];
+        }
+        
+        return min((int)(w << 6) + countTrailingZeros(bits), to);
+    }
+    
+    // Start of the first run of numSeats free seats in [from, to), or -1
+    static int findRun(const vector<uint64_t>& taken, int numSeats, int from, int to) {
+        int seat = nextWithState(taken, from, to, false);
+        
+        while (seat < to) {
+            int runEnd = nextWithState(taken, seat, to, true);
+            if (runEnd - seat >= numSeats) return seat;
+            seat = nextWithState(taken, runEnd, to, false);
+        }
+        
+        return -1;
+    }
+
+public:
+    static const int seatsPerCoach = 72;
+    
+    SeatMap(int totalSeats, int segments = 1)
+        : totalSeats(max(totalSeats, 0)), segments(max(segments, 1)),
+          wordsPerSegment((max(totalSeats, 0) + 63) / 64) {
+        words.assign(this->segments * wordsPerSegment, 0);
+        
+        // Padding bits past the last seat are permanently taken
+        for (int segment = 0; segment < this->segments; segment++) {
+            for (int seat = this->totalSeats; seat < (int)wordsPerSegment * 64; seat++) {
+                set(segment, seat);
+            }
+        }
+    }
+    
+    // Seat 0 is "A1", seat 72 is "B1"; coaches past Z continue as AA, AB, ...
+    static string seatLabel(int seat) {
+        int coach = seat / seatsPerCoach;
+        string letters;
+        do {
+            letters.insert(letters.begin(), char('A' + coach % 26));
+            coach = coach / 26 - 1;
+        } while (coach >= 0);
+        return letters + to_string(seat % seatsPerCoach + 1);
+    }
+    
+    // Inverse of seatLabel, -1 if the label is not one of ours
+    static int parseSeatLabel(const string& label) {
+        size_t i = 0;
+        int coach = 0;
+        while (i < label.size() && label[i] >= 'A' && label[i] <= 'Z') {
+            coach = coach * 26 + (label[i] - 'A' + 1);
+            i++;
+        }
+        if (i == 0 || i == label.size() || label.size() - i > 3) return -1;
+        
+        int number = 0;
+        for (; i < label.size(); i++) {
+            if (label[i] < '0' || label[i] > '9') return -1;
+            number = number * 10 + (label[i] - '0');
+        }
+        if (number < 1 || number > seatsPerCoach) return -1;
+        
+        return (coach - 1) * seatsPerCoach + number - 1;
+    }
+    
+    bool markOccupied(const string& label, int fromStop = 0, int toStop = -1) {
+        int seat = parseSeatLabel(label);
+        if (seat < 0 || seat >= totalSeats || !resolve(fromStop, toStop)) return false;
+        for (int segment = fromStop; segment < toStop; segment++) set(segment, seat);
+        return true;
+    }
+    
+    // Seats free from fromStop to toStop. Keep a group together: same coach first, then
+    // anywhere adjacent, then whatever is free.
+    vector<string> allocate(int numSeats, int fromStop = 0, int toStop = -1) {
+        vector<string> seats;
+        if (numSeats <= 0 || !resolve(fromStop, toStop)) return seats;
+        
+        vector<uint64_t> taken = takenAlong(fromStop, toStop);
+        
+        int start = -1;
+        for (int coachStart = 0; coachStart < totalSeats && start < 0; coachStart += seatsPerCoach) {
+            start = findRun(taken, numSeats, coachStart, min(coachStart + seatsPerCoach, totalSeats));
+        }
+        if (start < 0) {
+            start = findRun(taken, numSeats, 0, totalSeats);
+        }
+        
+        vector<int> picked;
+        if (start >= 0) {
+            for (int seat = start; seat < start + numSeats; seat++) picked.push_back(seat);
+        } else {
+            for (int seat = nextWithState(taken, 0, totalSeats, false);
+                 seat < totalSeats && (int)picked.size() < numSeats;
+                 seat = nextWithState(taken, seat + 1, totalSeats, false)) {
+                picked.push_back(seat);
+            }
+            if ((int)picked.size() < numSeats) return seats;
+        }
+        
+        for (int seat : picked) {
+            for (int segment = fromStop; segment < toStop; segment++) set(segment, seat);
+            seats.push_back(seatLabel(seat));
+        }
+        return seats;
+    }
+    
+    void release(const vector<string>& labels, int fromStop = 0, int toStop = -1) {
+        if (!resolve(fromStop, toStop)) return;
+        
+        for (const auto& label : labels) {
+            int seat = parseSeatLabel(label);
+            if (seat < 0 || seat >= totalSeats) continue;
+            for (int segment = fromStop; segment < toStop; segment++) clear(segment, seat);
+        }
+    }
+    
+    // Seats free on every segment from fromStop to toStop
+    int freeCount(int fromStop = 0, int toStop = -1) const {
+        if (!resolve(fromStop, toStop)) return 0;
+        
+        vector<uint64_t> taken = takenAlong(fromStop, toStop);
+        int count = 0;
+        for (int seat = nextWithState(taken, 0, totalSeats, false); seat < totalSeats;
+             seat = nextWithState(taken, seat + 1, totalSeats, false)) {
+            count++;
+        }
+        return count;
+    }
+};
+
+// Seat maps per (train, journey date), loaded lazily from the passengers table
+class SeatAllocator {
+public:
+    struct Entry {
+        mutex mtx;
+        SeatMap seats;
+        
+        Entry(SeatMap&& seats) : seats(move(seats)) {}
+    };
+
+private:
+    StripedMap<Entry> entries;
+
+public:
+    SeatAllocator() {}
+    
+    SeatAllocator(const SeatAllocator&) = delete;
+    SeatAllocator& operator=(const SeatAllocator&) = delete;
+    
+    Entry* find(int trainId, const string& journeyDate) {
+        return entries.find(SeatInventory::makeKey(trainId, journeyDate));
+    }
+    
+    // Insert a map built from the database; a concurrent loader that won the race is kept
+    Entry* load(int trainId, const string& journeyDate, SeatMap&& seats) {
+        return entries.insertIfAbsent(SeatInventory::makeKey(trainId, journeyDate),
+                                      unique_ptr<Entry>(new Entry(move(seats))));
+    }
+};
+
+// ============= WAITLIST =============
+// Bookings waiting for seats on one (train, journey date), loaded lazily from the bookings
+// table. The queue is a set of booking IDs, which are issued in booking order, so it is
+// first come, first served; joining, leaving and taking the head are O(log n) and a
+// cancellation never rescans the bookings.
+class Waitlist {
+public:
+    struct Waiter {
+        int bookingId;
+        int numPassengers;
+        int fromStop;
+        int toStop;
+    };
+    
+    struct Entry {
+        mutex mtx; // Guards everything below and serialises promotions
+        set<int> order; // Booking IDs
+        unordered_map<int, Waiter> waiters;
+    };
+
+private:
+    StripedMap<Entry> entries;
+
+public:
+    Entry* find(int trainId, const string& journeyDate) {
+        return entries.find(SeatInventory::makeKey(trainId, journeyDate));
+    }
+    
+    // Insert the waiters read from the database; a concurrent loader that won the race is kept
+    Entry* load(int trainId, const string& journeyDate, const vector<Waiter>& waiters) {
+        unique_ptr<Entry> entry(new Entry());
+        for (const auto& waiter : waiters) {
+            add(entry.get(), waiter);
+        }
+        return entries.insertIfAbsent(SeatInventory::makeKey(trainId, journeyDate), move(entry));
+    }
+    
+    // The rest take entry->mtx held; adding a booking twice is harmless
+    static void add(Entry* entry, const Waiter& waiter) {
+        if (entry->waiters.insert(make_pair(waiter.bookingId, waiter)).second) {
+            entry->order.insert(waiter.bookingId);
+        }
+    }
+    
+    static bool remove(Entry* entry, int bookingId) {
+        auto it = entry->waiters.find(bookingId);
+        if (it == entry->waiters.end()) {
+            return false;
+        }
+        
+        entry->order.erase(bookingId);
+        entry->waiters.erase(it);
+        return true;
+    }
+    
+    // nullptr if nobody is waiting
+    static const Waiter* head(Entry* entry) {
+        return entry->order.empty() ? nullptr : &entry->waiters[*entry->order.begin()];
+    }
+};
+
+// ============= TRAIN CLASSES =============
+// One stop on a train's route, in running order
+struct TrainStop {
+    string station;
+    string arrivalTime;   // Empty at the origin
+    string departureTime; // Empty at the terminus
+};
+
+class Train {
+private:
+    int trainId;
+    string trainName;
+    string trainNumber;
+    string source;
+    string destination;
+    string departureTime;
+    string arrivalTime;
+    int totalSeats;
+    vector<TrainStop> stops; // Empty for a nonstop train
+
+public:
+    Train() : trainId(0), trainName(""), trainNumber(""), source(""), destination(""),
+              departureTime(""), arrivalTime(""), totalSeats(0) {}
+    
+    Train(int id, string name, string number, string src, string dest, 
+          string depTime, string arrTime, int seats)
+        : trainId(id), trainName(name), trainNumber(number), source(src), destination(dest),
+          departureTime(depTime), arrivalTime(arrTime), totalSeats(seats) {}
+    
+    // Getters
+    int getTrainId() const { return trainId; }
+    string getTrainName() const { return trainName; }
+    string getTrainNumber() const { return trainNumber; }
+    string getSource() const { return source; }
+    string getDestination() const { return destination; }
+    string getDepartureTime() const { return departureTime; }
+    string getArrivalTime() const { return arrivalTime; }
+    int getTotalSeats() const { return totalSeats; }
+    
+    // Setters
+    void setTrainId(int id) { trainId = id; }
+    void setTrainName(const string& name) { trainName = name; }
+    void setTrainNumber(const string& number) { trainNumber = number; }
+    void setSource(const string& src) { source = src; }
+    void setDestination(const string& dest) { destination = dest; }
+    void setDepartureTime(const string& depTime) { departureTime = depTime; }
+    void setArrivalTime(const string& arrTime) { arrivalTime = arrTime; }
+    void setTotalSeats(int seats) { totalSeats = seats; }
+    void setStops(const vector<TrainStop>& route) { stops = route; }
+    
+    // Every stop from source to destination; a nonstop train has just those two
+    vector<TrainStop> getStops() const {
+        if (!stops.empty()) {
+            return stops;
+        }
+        
+        TrainStop origin = { source, "", departureTime };
+        TrainStop terminus = { destination, arrivalTime, "" };
+        return { origin, terminus };
+    }
+    
+    int getStopCount() const { return stops.empty() ? 2 : (int)stops.size(); }
+    
+    // Stop by index; a negative index is the final stop
+    TrainStop getStop(int index) const {
+        vector<TrainStop> route = getStops();
+        return route[index < 0 || index >= (int)route.size() ? route.size() - 1 : index];
+    }
+    
+    // Index of a stop by station name (case-insensitive), or -1 if the train does not call there
+    int findStop(const string& station) const {
+        vector<TrainStop> route = getStops();
+        for (size_t i = 0; i < route.size(); i++) {
+            const string& name = route[i].station;
+            if (name.size() == station.size() &&
+                equal(name.begin(), name.end(), station.begin(), [](char a, char b) {
+                    return tolower((unsigned char)a) == tolower((unsigned char)b);
+                })) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+    
+    // A negative fare leaves the fare column out
+    void displayInfo(double fare = -1.0) const {
+        cout << left << setw(5) << trainId
+             << setw(20) << trainName
+             << setw(12) << trainNumber
+             << setw(15) << source
+             << setw(15) << destination
+             << setw(12) << departureTime
+             << setw(12) << arrivalTime
+             << setw(8) << totalSeats;
+        if (fare >= 0.0) {
+            cout << "$" << fixed << setprecision(2) << fare;
+        }
+        cout << endl;
+    }
+    
+    static void displayHeader(bool withFare = false) {
+        cout << left << setw(5) << "ID"
+             << setw(20) << "Train Name"
+             << setw(12) << "Number"
+             << setw(15) << "Source"
+             << setw(15) << "Destination"
+             << setw(12) << "Departure"
+             << setw(12) << "Arrival"
+             << setw(8) << "Seats";
+        if (withFare) {
+            cout << "Fare";
+        }
+        cout << endl;
+        cout << string(withFare ? 109 : 99, '-') << endl;
+    }
+};
+
+// ============= STATION SEARCH =============
+// Case-folded trigram index over station names plus a source -> (destination, train)
+// adjacency list, so substring searches never scan the trains table.
+class StationIndex {
+private:
+    vector<string> foldedNames;                          // Indexed by station ID
+    unordered_map<string, int> stationIds;               // Folded name -> station ID
+    unordered_map<uint32_t, vector<int>> trigrams;       // Trigram -> sorted station IDs
+    vector<vector<pair<int, int>>> routesFrom;           // Station ID -> (destination ID, train ID)
+    
+    static uint32_t trigramKey(const string& text, size_t pos) {
+        return (uint32_t((unsigned char)text[pos]) << 16) |
+               (uint32_t((unsigned char)text[pos + 1]) << 8) |
+               uint32_t((unsigned char)text[pos + 2]);
+    }
+    
+    int addStation(const string& name) {
+        string folded = fold(name);
+        auto it = stationIds.find(folded);
+        if (it != stationIds.end()) return it->second;
+        
+        int id = foldedNames.size();
+        foldedNames.push_back(folded);
+        stationIds[folded] = id;
+        routesFrom.push_back(vector<pair<int, int>>());
+        
+        for (size_t pos = 0; pos + 3 <= folded.size(); pos++) {
+            vector<int>& postings = trigrams[trigramKey(folded, pos)];
+            if (postings.empty() || postings.back() != id) postings.push_back(id);
+        }
+        return id;
+    }
+
+public:
+    static string fold(const string& text) {
+        string folded;
+        folded.reserve(text.size());
+        for (char c : text) folded += (char)tolower((unsigned char)c);
+        return folded;
+    }
+    
+    StationIndex(const vector<shared_ptr<const Train>>& trains) {
+        for (const auto& train : trains) {
+            int source = addStation(train->getSource());
+            int destination = addStation(train->getDestination());
+            routesFrom[source].push_back(make_pair(destination, train->getTrainId()));
+        }
+    }
+    
+    size_t stationCount() const { return foldedNames.size(); }
+    
+    // Station ID for an exact (case-insensitive) name, or -1
+    int findStation(const string& name) const {
+        auto it = stationIds.find(fold(name));
+        return it != stationIds.end() ? it->second : -1;
+    }
+    
+    // Station IDs whose name contains the query as a case-insensitive substring
+    vector<bool> matchStations(const string& query) const {
+        string folded = fold(query);
+        vector<bool> matched(foldedNames.size(), folded.empty());
+        if (folded.empty()) return matched;
+        
+        if (folded.size() < 3) {
+            for (size_t id = 0; id < foldedNames.size(); id++) {
+                matched[id] = foldedNames[id].find(folded) != string::npos;
+            }
+            return matched;
+        }
+        
+        // Intersect the posting lists of every trigram, shortest first, then verify
+        vector<const vector<int>*> lists;
+        for (size_t pos = 0; pos + 3 <= folded.size(); pos++) {
+            auto it = trigrams.find(trigramKey(folded, pos));
+            if (it == trigrams.end()) return matched;
+            lists.push_back(&it->second);
+        }
+        sort(lists.begin(), lists.end(), [](const vector<int>* a, const vector<int>* b) {
+            return a->size() < b->size();
+        });
+        
+        vector<int> candidates = *lists[0];
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+            vector<int> narrowed;
+            set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+                             back_inserter(narrowed));
+            candidates.swap(narrowed);
+        }
+        
+        for (int id : candidates) {
+            if (foldedNames[id].find(folded) != string::npos) matched[id] = true;
+        }
+        return matched;
+    }
+    
+    // Same matches as "source LIKE %x% AND destination LIKE %y%", as sorted train IDs
+    vector<int> findTrains(const string& source, const string& destination) const {
+        vector<bool> sources = matchStations(source);
+        vector<bool> destinations = matchStations(destination);
+        
+        vector<int> trainIds;
+        for (size_t id = 0; id < sources.size(); id++) {
+            if (!sources[id]) continue;
+            for (const auto& route : routesFrom[id]) {
+                if (destinations[route.first]) trainIds.push_back(route.second);
+            }
+        }
+        
+        sort(trainIds.begin(), trainIds.end());
+        return trainIds;
+    }
+};
+
+// Prefix completion over station names, ranked by how many bookings their routes carry.
+// Names are kept sorted so a prefix is one contiguous range, and a sparse table over
+// popularity pulls the top k out of that range without visiting all of it.
+class StationAutocomplete {
+private:
+    vector<string> names;                   // Display names, sorted by folded name
+    vector<string> foldedNames;
+    vector<unsigned long long> popularity;
+    vector<vector<int>> best;               // best[j][i]: most popular index in [i, i + 2^j)
+    
+    int morePopular(int a, int b) const {
+        return popularity[b] > popularity[a] ? b : a;
+    }
+    
+    // Most popular index in the non-empty range [lo, hi)
+    int mostPopular(int lo, int hi) const {
+        int level = 0;
+        while ((2 << level) <= hi - lo) level++;
+        return morePopular(best[level][lo], best[level][hi - (1 << level)]);
+    }
+    
+    static bool withinOneEdit(const string& a, const string& b) {
+        if (a.size() > b.size() + 1 || b.size() > a.size() + 1) return false;
+        
+        size_t i = 0, j = 0;
+        bool edited = false;
+        while (i < a.size() && j < b.size()) {
+            if (a[i] == b[j]) {
+                i++;
+                j++;
+                continue;
+            }
+            if (edited) return false;
+            edited = true;
+            if (a.size() > b.size()) i++;
+            else if (b.size() > a.size()) j++;
+            else { i++; j++; }
+        }
+        return !edited || (i == a.size() && j == b.size());
+    }
+    
+    vector<string> topK(vector<int> candidates, size_t k) const {
+        sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+            return popularity[a] != popularity[b] ? popularity[a] > popularity[b] : a < b;
+        });
+        
+        vector<string> result;
+        for (size_t i = 0; i < candidates.size() && i < k; i++) {
+            result.push_back(names[candidates[i]]);
+        }
+        return result;
+    }
+
+public:
+    // One (display name, popularity) pair per distinct station
+    StationAutocomplete(vector<pair<string, unsigned long long>> stations) {
+        sort(stations.begin(), stations.end(),
+             [](const pair<string, unsigned long long>& a, const pair<string, unsigned long long>& b) {
+                 return StationIndex::fold(a.first) < StationIndex::fold(b.first);
+             });
+        
+        for (const auto& station : stations) {
+            names.push_back(station.first);
+            foldedNames.push_back(StationIndex::fold(station.first));
+            popularity.push_back(station.second);
+        }
+        
+        int n = names.size();
+        best.push_back(vector<int>(n));
+        for (int i = 0; i < n; i++) best[0][i] = i;
+        
+        for (int level = 1; (1 << level) <= n; level++) {
+            const vector<int>& previous = best[level - 1];
+            vector<int> current(n - (1 << level) + 1);
+            for (size_t i = 0; i < current.size(); i++) {
+                current[i] = morePopular(previous[i], previous[i + (1 << (level - 1))]);
+            }
+            best.push_back(current);
+        }
+    }
+    
+    // Up to k station names starting with prefix, most popular first. If nothing starts
+    // with it, names whose opening letters are one typo away are offered instead.
+    vector<string> complete(const string& prefix, size_t k) const {
+        string folded = StationIndex::fold(prefix);
+        
+        auto first = lower_bound(foldedNames.begin(), foldedNames.end(), folded);
+        auto last = upper_bound(first, foldedNames.end(), folded, [](const string& p, const string& name) {
+            return name.compare(0, p.size(), p) > 0;
+        });
+        int lo = first - foldedNames.begin();
+        int hi = last - foldedNames.begin();
+        
+        vector<string> result;
+        
+        if (lo < hi) {
+            // Best of a range, then best of what is left on either side of it
+            struct Range {
+                unsigned long long popularity;
+                int index, from, to;
+                bool operator<(const Range& other) const {
+                    return popularity != other.popularity ? popularity < other.popularity : index > other.index;
+                }
+            };
+            
+            priority_queue<Range> ranges;
+            auto pushRange = [&](int from, int to) {
+                if (from < to) {
+                    int index = mostPopular(from, to);
+                    ranges.push(Range{popularity[index], index, from, to});
+                }
+            };
+            
+            pushRange(lo, hi);
+            while (!ranges.empty() && result.size() < k) {
+                Range range = ranges.top();
+                ranges.pop();
+                
+                result.push_back(names[range.index]);
+                pushRange(range.from, range.index);
+                pushRange(range.index + 1, range.to);
+            }
+            return result;
+        }
+        
+        if (folded.empty()) return result;
+        
+        vector<int> candidates;
+        for (size_t i = 0; i < foldedNames.size(); i++) {
+            const string& name = foldedNames[i];
+            for (size_t length = folded.size() > 0 ? folded.size() - 1 : 0; length <= folded.size() + 1; length++) {
+                if (length <= name.size() && withinOneEdit(folded, name.substr(0, length))) {
+                    candidates.push_back(i);
+                    break;
+                }
+            }
+        }
+        return topK(candidates, k);
+    }
+};
+
+// ============= JOURNEY PLANNER =============
+// One train of a journey; times are minutes after midnight of the travel date and run
+// past 1440 on later days
+struct JourneyLeg {
+    shared_ptr<const Train> train;
+    int departure;
+    int arrival;
+};
+
+struct Journey {
+    vector<JourneyLeg> legs;
+    
+    int departure() const { return legs.front().departure; }
+    int arrival() const { return legs.back().arrival; }
+    int transfers() const { return (int)legs.size() - 1; }
+    
+    // HH:MM, with +Nd when it falls N days after the travel date
+    static string formatTime(int minutes) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "%02d:%02d", minutes % 1440 / 60, minutes % 60);
+        string text = buffer;
+        if (minutes >= 1440) text += "+" + to_string(minutes / 1440) + "d";
+        return text;
+    }
+};
+
+// Connection scan over the timetable. Every train is one daily connection from its source
+// to its destination; the connections sit in a flat array sorted by departure time, and
+// one pass over it computes, per round k, the earliest arrival at each station using
+// exactly k trains. That gives the fastest journey for each number of transfers at once.
+class JourneyPlanner {
+private:
+    struct Connection {
+        int from;
+        int to;
+        int departure; // Minutes after midnight
+        int arrival;   // Later than departure; overnight trains arrive past 1440
+        int train;     // Index into trains
+    };
+    
+    vector<Connection> connections;
+    vector<shared_ptr<const Train>> trains;
+    size_t stationCount;
+    
+    const int minTransferMinutes = 15;
+    const int searchDays = 2; // Every leg departs within this many days of the travel date
+
+public:
+    // Station IDs are the ones the station index assigned
+    JourneyPlanner(const vector<shared_ptr<const Train>>& allTrains, const StationIndex& stations)
+        : stationCount(stations.stationCount()) {
+        for (const auto& train : allTrains) {
+            int departure = Utility::minutesOfDay(train->getDepartureTime());
+            int arrival = Utility::minutesOfDay(train->getArrivalTime());
+            if (departure < 0 || arrival < 0) {
+                continue;
+            }
+            
+            Connection connection;
+            connection.from = stations.findStation(train->getSource());
+            connection.to = stations.findStation(train->getDestination());
+            connection.departure = departure;
+            connection.arrival = arrival > departure ? arrival : arrival + 1440;
+            connection.train = (int)trains.size();
+            
+            trains.push_back(train);
+            connections.push_back(connection);
+        }
+        
+        sort(connections.begin(), connections.end(), [](const Connection& a, const Connection& b) {
+            return a.departure < b.departure;
+        });
+    }
+    
+    // Fastest journeys from any origin station to any destination station leaving at or
+    // after departAfter (minutes after midnight), with up to maxTransfers changes. Only
+    // journeys that arrive earlier than every journey with fewer transfers are returned,
+    // fewest transfers first.
+    vector<Journey> plan(const vector<bool>& origins, const vector<bool>& destinations,
+                         int departAfter, int maxTransfers) const {
+        const int unreached = INT_MAX;
+        int rounds = maxTransfers + 1;
+        size_t width = stationCount;
+        
+        // Row k holds round k; flat so one round is one contiguous run of memory
+        vector<int> arrival((rounds + 1) * width, unreached);
+        vector<int> parent((rounds + 1) * width, -1); // Day * connections + connection index
+        vector<int> best(rounds + 1, unreached);       // Earliest arrival at a destination
+        vector<int> bestStation(rounds + 1, -1);
+        vector<int> limit(rounds + 1, unreached);      // Min of best over rounds 1..k
+        
+        for (size_t station = 0; station < width; station++) {
+            if (origins[station]) arrival[station] = departAfter;
+        }
+        
+        const Connection* begin = connections.data();
+        size_t firstToday = lower_bound(connections.begin(), connections.end(), departAfter,
+            [](const Connection& c, int time) { return c.departure < time; }) - connections.begin();
+        
+        for (int day = 0; day < searchDays; day++) {
+            int offset = day * 1440;
+            
+            for (size_t i = day == 0 ? firstToday : 0; i < connections.size(); i++) {
+                const Connection& c = begin[i];
+                int departure = c.departure + offset;
+                int arrivalTime = c.arrival + offset;
+                
+                // Nothing departing now can beat the direct journey already found
+                if (departure >= limit[1]) {
+                    day = searchDays;
+                    break;
+                }
+                
+                for (int k = 1; k <= rounds; k++) {
+                    int ready = arrival[(k - 1) * width + c.from];
+                    if (ready == unreached || arrivalTime >= limit[k]) continue;
+                    if (k > 1) ready += minTransferMinutes;
+                    if (ready > departure) continue;
+                    
+                    int& reached = arrival[k * width + c.to];
+                    if (arrivalTime >= reached) continue;
+                    
+                    reached = arrivalTime;
+                    parent[k * width + c.to] = day * (int)connections.size() + (int)i;
+                    
+                    if (destinations[c.to] && arrivalTime < best[k]) {
+                        best[k] = arrivalTime;
+                        bestStation[k] = c.to;
+                        for (int j = k; j <= rounds; j++) {
+                            limit[j] = min(limit[j], arrivalTime);
+                        }
+                    }
+                }
+            }
+        }
+        
+        vector<Journey> journeys;
+        int earliest = unreached;
+        for (int k = 1; k <= rounds; k++) {
+            if (best[k] >= earliest) continue;
+            earliest = best[k];
+            
+            Journey journey;
+            int station = bestStation[k];
+            for (int round = k; round >= 1; round--) {
+                int index = parent[round * width + station];
+                const Connection& c = connections[index % connections.size()];
+                int offset = index / (int)connections.size() * 1440;
+                
+                JourneyLeg leg;
+                leg.train = trains[c.train];
+                leg.departure = c.departure + offset;
+                leg.arrival = c.arrival + offset;
+                journey.legs.push_back(leg);
+                station = c.from;
+            }
+            
+            reverse(journey.legs.begin(), journey.legs.end());
+            journeys.push_back(journey);
+        }
+        
+        return journeys;
+    }
+};
+
+// ============= TRAIN CATALOG =============
+// Read-mostly cache of the trains table. Readers grab an immutable snapshot
+// without locking; writers publish a new snapshot. Bumping the version makes
+// every existing snapshot stale, so the next lookup reloads from the database.
+class TrainCatalog {
+private:
+    struct Snapshot {
+        unsigned long long version;
+        unordered_map<int, shared_ptr<const Train>> trains;
+        shared_ptr<const StationIndex> stations;
+        shared_ptr<const JourneyPlanner> planner;
+        
+        void buildIndexes() {
+            vector<shared_ptr<const Train>> all;
+            for (const auto& entry : trains) all.push_back(entry.second);
+            sort(all.begin(), all.end(), [](const shared_ptr<const Train>& a, const shared_ptr<const Train>& b) {
+                return a->getTrainId() < b->getTrainId();
+            });
+            stations = make_shared<const StationIndex>(all);
+            planner = make_shared<const JourneyPlanner>(all, *stations);
+        }
+    };
+    
+    shared_ptr<const Snapshot> snapshot; // Accessed only through atomic_load/atomic_store
+    atomic<unsigned long long> version;
+    mutex writeMutex;
+
+public:
+    TrainCatalog() : version(1) {}
+    
+    TrainCatalog(const TrainCatalog&) = delete;
+    TrainCatalog& operator=(const TrainCatalog&) = delete;
+    
+    unsigned long long currentVersion() const { return version.load(); }
+    
+    bool isCurrent() const {
+        shared_ptr<const Snapshot> current = atomic_load(&snapshot);
+        return current && current->version == version.load();
+    }
+    
+    // nullptr if the train is unknown or the snapshot is stale
+    shared_ptr<const Train> find(int trainId) const {
+        shared_ptr<const Snapshot> current = atomic_load(&snapshot);
+        if (!current || current->version != version.load()) {
+            return nullptr;
+        }
+        
+        auto it = current->trains.find(trainId);
+        return it != current->trains.end() ? it->second : nullptr;
+    }
+    
+    // Trains whose source and destination contain the given text; false if the snapshot is stale
+    bool searchTrains(const string& source, const string& destination, vector<Train>& result) const {
+        shared_ptr<const Snapshot> current = atomic_load(&snapshot);
+        if (!current || current->version != version.load()) {
+            return false;
+        }
+        
+        for (int trainId : current->stations->findTrains(source, destination)) {
+            result.push_back(*current->trains.at(trainId));
+        }
+        return true;
+    }
+    
+    // Fastest journeys between stations whose names contain the given text, leaving at or
+    // after departAfter minutes past midnight; false if the snapshot is stale
+    bool planJourneys(const string& source, const string& destination, int departAfter, int maxTransfers,
+                      vector<Journey>& result) const {
+        shared_ptr<const Snapshot> current = atomic_load(&snapshot);
+        if (!current || current->version != version.load()) {
+            return false;
+        }
+        
+        result = current->planner->plan(current->stations->matchStations(source),
+                                         current->stations->matchStations(destination), departAfter, maxTransfers);
+        return true;
+    }
+    
+    // Replace the whole catalog with trains read while the catalog was at loadedVersion
+    void publish(const vector<Train>& trains, unsigned long long loadedVersion) {
+        shared_ptr<Snapshot> fresh = make_shared<Snapshot>();
+        fresh->version = loadedVersion;
+        for (const auto& train : trains) {
+            fresh->trains[train.getTrainId()] = make_shared<const Train>(train);
+        }
+        fresh->buildIndexes();
+        
+        lock_guard<mutex> lock(writeMutex);
+        atomic_store(&snapshot, shared_ptr<const Snapshot>(fresh));
+    }
+    
+    // Copy-on-write insert of one train added after the last full load
+    void add(const shared_ptr<const Train>& train) {
+        lock_guard<mutex> lock(writeMutex);
+        shared_ptr<const Snapshot> current = atomic_load(&snapshot);
+        if (!current || current->version != version.load()) {
+            return;
+        }
+        
+        shared_ptr<Snapshot> fresh = make_shared<Snapshot>(*current);
+        fresh->trains[train->getTrainId()] = train;
+        fresh->buildIndexes();
+        atomic_store(&snapshot, shared_ptr<const Snapshot>(fresh));
+    }
+    
+    void invalidate() {
+        version++;
+    }
+};
+
+// ============= FARE ENGINE =============
+// Fare rules in the form they are written down: tapered per-km rates, train classes,
+// passenger age bands and date adjustments. FareEngine compiles them once into flat
+// lookup tables, so quoting needs no branching over the rules and no storage access.
+struct FareRules {
+    struct DistanceBand {
+        int upToKm;
+        double ratePerKm; // For the kilometres inside this band
+    };
+    
+    // The first class whose keyword appears in the train name applies; the entry with an
+    // empty keyword is the default
+    struct TrainClass {
+        string nameKeyword;
+        double multiplier;
+        double reservationCharge; // Per paying passenger
+        double averageSpeedKmh;   // For estimating distances missing from routeDistances
+    };
+    
+    struct AgeBand {
+        int upToAge;
+        double multiplier; // 0 travels free
+    };
+    
+    struct AdvanceBand {
+        int upToDaysAhead;
+        double multiplier;
+    };
+    
+    struct RouteDistance {
+        string source;
+        string destination;
+        int km;
+    };
+    
+    double minimumFare; // Per full-fare passenger, before the reservation charge
+    vector<DistanceBand> distanceBands;
+    vector<TrainClass> trainClasses;
+    vector<AgeBand> ageBands;
+    vector<AdvanceBand> advanceBands;
+    double weekdayMultipliers[7]; // Sunday first
+    vector<RouteDistance> routeDistances;
+    
+    static FareRules standard() {
+        FareRules rules;
+        rules.minimumFare = 5.0;
+        rules.distanceBands = { {300, 0.060}, {1000, 0.040}, {2500, 0.030}, {5000, 0.020} };
+        rules.trainClasses = {
+            {"rajdhani", 1.50, 3.0, 85.0},
+            {"shatabdi", 1.40, 3.0, 80.0},
+            {"duronto", 1.30, 2.5, 75.0},
+            {"", 1.00, 1.5, 55.0}
+        };
+        rules.ageBands = { {4, 0.0}, {11, 0.5}, {59, 1.0}, {200, 0.6} };
+        rules.advanceBands = { {1, 1.30}, {7, 1.10}, {60, 1.00}, {120, 0.95} };
+        
+        double weekdays[7] = { 1.10, 1.00, 1.00, 1.00, 1.00, 1.10, 1.05 };
+        copy(weekdays, weekdays + 7, rules.weekdayMultipliers);
+        
+        rules.routeDistances = {
+            {"Delhi", "Mumbai", 1384},
+            {"Chennai", "Bangalore", 362},
+            {"Kolkata", "Delhi", 1453}
+        };
+        return rules;
+    }
+};
+
+class FareEngine {
+private:
+    struct CompiledClass {
+        string keyword;
+        double multiplier;
+        double reservationCharge;
+        double averageSpeedKmh;
+    };
+    
+    double minimumFare;
+    vector<double> baseFareByKm;     // Cumulative tapered fare for 0..maxTableKm km
+    double rateBeyondTable;
+    vector<double> ageMultipliers;   // By age in years
+    vector<double> advanceMultipliers; // By days between today and the journey
+    double weekdayMultipliers[7];
+    vector<CompiledClass> classes;   // Default class last
+    unordered_map<string, int> routeKm; // Folded "source|destination", both directions
+    
+    static string routeKey(const string& source, const string& destination) {
+        return StationIndex::fold(source) + "|" + StationIndex::fold(destination);
+    }
+    
+    const CompiledClass& classFor(const Train& train) const {
+        string name = StationIndex::fold(train.getTrainName());
+        for (const auto& trainClass : classes) {
+            if (trainClass.keyword.empty() || name.find(trainClass.keyword) != string::npos) {
+                return trainClass;
+            }
+        }
+        return classes.back();
+    }
+    
+    double baseFare(int km) const {
+        int maxTableKm = (int)baseFareByKm.size() - 1;
+        if (km <= maxTableKm) {
+            return baseFareByKm[max(km, 0)];
+        }
+        return baseFareByKm[maxTableKm] + (km - maxTableKm) * rateBeyondTable;
+    }
+    
+    double ageMultiplier(int age) const {
+        // Unknown ages pay full fare
+        return age >= 0 && age < (int)ageMultipliers.size() ? ageMultipliers[age] : 1.0;
+    }
+    
+    // Weekday and booking-ahead adjustment for a journey date; 1 if the date is unparsable
+    double dateMultiplier(const string& journeyDate) const {
+        long journeyDay, today;
+        if (!Utility::dayNumber(journeyDate, journeyDay) ||
+            !Utility::dayNumber(Utility::getCurrentDate(), today)) {
+            return 1.0;
+        }
+        
+        long daysAhead = min(max(journeyDay - today, 0L), (long)advanceMultipliers.size() - 1);
+        int weekday = (int)(((journeyDay + 4) % 7 + 7) % 7); // 1970-01-01 was a Thursday
+        return weekdayMultipliers[weekday] * advanceMultipliers[daysAhead];
+    }
+    
+    // Known route distance, else running time at the class's average speed (overnight
+    // trains arrive the next day)
+    int distanceKm(const Train& train, const CompiledClass& trainClass) const {
+        auto it = routeKm.find(routeKey(train.getSource(), train.getDestination()));
+        if (it != routeKm.end()) {
+            return it->second;
+        }
+        
+        int departure = Utility::minutesOfDay(train.getDepartureTime());
+        int arrival = Utility::minutesOfDay(train.getArrivalTime());
+        if (departure < 0 || arrival < 0) {
+            return 0;
+        }
+        
+        int runningMinutes = arrival > departure ? arrival - departure : arrival + 24 * 60 - departure;
+        return (int)(runningMinutes * trainClass.averageSpeedKmh / 60.0);
+    }
+    
+    // Share of the route distance between two stops, split by running time when every stop
+    // has its times and evenly between stops otherwise
+    static double routeShare(const Train& train, int fromStop, int toStop) {
+        vector<TrainStop> route = train.getStops();
+        int last = (int)route.size() - 1;
+        if (toStop < 0 || toStop > last) toStop = last;
+        fromStop = min(max(fromStop, 0), toStop);
+        
+        // Minutes from the origin's departure to each stop; times wrap past midnight
+        vector<int> elapsed(route.size(), 0);
+        int previous = Utility::minutesOfDay(route[0].departureTime);
+        bool timed = previous >= 0;
+        for (int i = 1; i <= last && timed; i++) {
+            int arrival = Utility::minutesOfDay(route[i].arrivalTime);
+            timed = arrival >= 0;
+            elapsed[i] = elapsed[i - 1] + ((arrival - previous) % 1440 + 1440) % 1440;
+            
+            int departure = i < last ? Utility::minutesOfDay(route[i].departureTime) : -1;
+            if (departure >= 0) {
+                elapsed[i] += ((departure - arrival) % 1440 + 1440) % 1440;
+                previous = departure;
+            } else {
+                previous = arrival;
+            }
+        }
+        
+        if (timed && elapsed[last] > 0) {
+            return (double)(elapsed[toStop] - elapsed[fromStop]) / elapsed[last];
+        }
+        return last > 0 ? (double)(toStop - fromStop) / last : 1.0;
+    }
+    
+    // Sum of the passengers' age multipliers; payingPassengers counts everyone not travelling free
+    double partyMultiplier(const vector<int>& passengerAges, int& payingPassengers) const {
+        double multiplier = 0.0;
+        payingPassengers = 0;
+        for (int age : passengerAges) {
+            double passengerMultiplier = ageMultiplier(age);
+            multiplier += passengerMultiplier;
+            if (passengerMultiplier > 0.0) payingPassengers++;
+        }
+        return multiplier;
+    }
+    
+    double fareFor(const CompiledClass& trainClass, int km, double party, int payingPassengers, double dateFactor) const {
+        double adultFare = max(minimumFare, baseFare(km) * trainClass.multiplier * dateFactor);
+        double fare = adultFare * party + trainClass.reservationCharge * payingPassengers;
+        return floor(fare * 100.0 + 0.5) / 100.0;
+    }
+
+public:
+    FareEngine(const FareRules& rules = FareRules::standard()) : minimumFare(rules.minimumFare) {
+        // Distance: running total of the tapered rate, one entry per km
+        int maxTableKm = rules.distanceBands.empty() ? 0 : rules.distanceBands.back().upToKm;
+        baseFareByKm.assign(maxTableKm + 1, 0.0);
+        
+        size_t band = 0;
+        for (int km = 1; km <= maxTableKm; km++) {
+            while (rules.distanceBands[band].upToKm < km) band++;
+            baseFareByKm[km] = baseFareByKm[km - 1] + rules.distanceBands[band].ratePerKm;
+        }
+        rateBeyondTable = rules.distanceBands.empty() ? 0.0 : rules.distanceBands.back().ratePerKm;
+        
+        // Age: the band covering each year of age
+        int maxAge = rules.ageBands.empty() ? -1 : rules.ageBands.back().upToAge;
+        ageMultipliers.assign(maxAge + 1, 1.0);
+        band = 0;
+        for (int age = 0; age <= maxAge; age++) {
+            while (rules.ageBands[band].upToAge < age) band++;
+            ageMultipliers[age] = rules.ageBands[band].multiplier;
+        }
+        
+        // Booking ahead: the band covering each day; later days use the last band
+        int maxDays = rules.advanceBands.empty() ? 0 : rules.advanceBands.back().upToDaysAhead;
+        advanceMultipliers.assign(maxDays + 1, rules.advanceBands.empty() ? 1.0 : rules.advanceBands.back().multiplier);
+        band = 0;
+        for (int days = 0; days <= maxDays && !rules.advanceBands.empty(); days++) {
+            while (rules.advanceBands[band].upToDaysAhead < days) band++;
+            advanceMultipliers[days] = rules.advanceBands[band].multiplier;
+        }
+        
+        copy(rules.weekdayMultipliers, rules.weekdayMultipliers + 7, weekdayMultipliers);
+        
+        for (const auto& trainClass : rules.trainClasses) {
+            classes.push_back({ StationIndex::fold(trainClass.nameKeyword), trainClass.multiplier,
+                                trainClass.reservationCharge, trainClass.averageSpeedKmh });
+        }
+        if (classes.empty() || !classes.back().keyword.empty()) {
+            classes.push_back({ "", 1.0, 0.0, 55.0 });
+        }
+        
+        for (const auto& route : rules.routeDistances) {
+            routeKm[routeKey(route.source, route.destination)] = route.km;
+            routeKm[routeKey(route.destination, route.source)] = route.km;
+        }
+    }
+    
+    // Total fare on each train for the same passengers (ages; -1 if unknown) and date.
+    // The party and date terms are worked out once, then each train costs one lookup
+    // and a multiply-add.
+    vector<double> quote(const vector<Train>& trains, const string& journeyDate, const vector<int>& passengerAges) const {
+        int payingPassengers;
+        double party = partyMultiplier(passengerAges, payingPassengers);
+        double dateFactor = dateMultiplier(journeyDate);
+        
+        vector<double> fares(trains.size());
+        for (size_t i = 0; i < trains.size(); i++) {
+            const CompiledClass& trainClass = classFor(trains[i]);
+            fares[i] = fareFor(trainClass, distanceKm(trains[i], trainClass), party, payingPassengers, dateFactor);
+        }
+        return fares;
+    }
+    
+    // Fare between two stops (toStop -1 is the final stop), charged on that share of the
+    // route distance
+    double quote(const Train& train, const string& journeyDate, const vector<int>& passengerAges,
+                 int fromStop = 0, int toStop = -1) const {
+        int payingPassengers;
+        double party = partyMultiplier(passengerAges, payingPassengers);
+        const CompiledClass& trainClass = classFor(train);
+        int km = (int)(distanceKm(train, trainClass) * routeShare(train, fromStop, toStop) + 0.5);
+        return fareFor(trainClass, km, party, payingPassengers, dateMultiplier(journeyDate));
+    }
+    
+    int distanceKm(const Train& train) const {
+        return distanceKm(train, classFor(train));
+    }
+};
+
+struct RouteBookingCount {
+    string source;
+    string destination;
+    unsigned long long bookings;
+};
+
+// A seat held by a confirmed booking between two stops; toStop -1 is the final stop
+struct SeatAssignment {
+    string seatNumber;
+    int fromStop;
+    int toStop;
+};
+
+// Storage operations behind TrainManager; see STORAGE BACKENDS for implementations
+class TrainRepository {
+protected:
+    // Count numSeats as taken on each segment between the two stops
+    static void takeSeats(vector<int>& availableBySegment, int fromStop, int toStop, int numSeats) {
+        int end = toStop < 0 ? (int)availableBySegment.size() : min(toStop, (int)availableBySegment.size());
+        for (int segment = max(fromStop, 0); segment < end; segment++) {
+            availableBySegment[segment] -= numSeats;
+        }
+    }
+
+public:
+    virtual ~TrainRepository() {}
+    
+    // Trains come with their stops
+    virtual vector<Train> getAllTrains() = 0;
+    virtual bool findTrain(int trainId, Train& train) = 0;
+    virtual vector<Train> searchTrains(const string& source, const string& destination) = 0;
+    
+    // Seats left on each segment of (train, date) after confirmed bookings, segment i
+    // running from stop i to stop i + 1; false if the train is unknown
+    virtual bool countAvailableSeats(int trainId, const string& journeyDate, vector<int>& availableBySegment) = 0;
+    
+    // countAvailableSeats for many trains and dates from one pass over the bookings. Cell
+    // t * journeyDates.size() + d is trainIds[t] on journeyDates[d], empty if the train is unknown.
+    virtual void countAvailableSeatsForDates(const vector<int>& trainIds, const vector<string>& journeyDates,
+                                             vector<vector<int>>& availableBySegment) = 0;
+    
+    // Total seats, number of stops and the seats held by confirmed bookings; false if the
+    // train is unknown
+    virtual bool getSeatAssignments(int trainId, const string& journeyDate, int& totalSeats,
+                                    int& stopCount, vector<SeatAssignment>& seats) = 0;
+    
+    // Confirmed bookings per train, for ranking stations
+    virtual vector<RouteBookingCount> getRouteBookingCounts() = 0;
+};
+
+class TrainManager {
+private:
+    TrainRepository* trainRepository;
+    ThreadPool* executor;
+    SeatInventory seatInventory;
+    SeatAllocator seatAllocator;
+    TrainCatalog trainCatalog;
+    FareEngine fareEngine;
+    
+    struct AutocompleteState {
+        shared_ptr<const StationAutocomplete> engine;
+        unsigned long long catalogVersion;
+        chrono::steady_clock::time_point builtAt;
+    };
+    
+    shared_ptr<const AutocompleteState> autocompleteState; // Accessed only through atomic_load/atomic_store
+    mutex autocompleteRebuildMutex;
+    const chrono::minutes autocompleteRefreshInterval = chrono::minutes(10);
+    
+    bool autocompleteIsFresh(const shared_ptr<const AutocompleteState>& state) const {
+        return state && state->catalogVersion == trainCatalog.currentVersion() &&
+               chrono::steady_clock::now() - state->builtAt < autocompleteRefreshInterval;
+    }
+    
+    // Rebuild the completion engine with station popularity taken from confirmed bookings
+    shared_ptr<const AutocompleteState> rebuildAutocomplete() {
+        lock_guard<mutex> lock(autocompleteRebuildMutex);
+        
+        shared_ptr<const AutocompleteState> state = atomic_load(&autocompleteState);
+        if (autocompleteIsFresh(state)) {
+            return state;
+        }
+        
+        unsigned long long catalogVersion = trainCatalog.currentVersion();
+        
+        try {
+            // Every train counts once, so stations nobody has booked yet still rank by service
+            unordered_map<string, pair<string, unsigned long long>> stations;
+            for (const auto& route : trainRepository->getRouteBookingCounts()) {
+                const string* endpoints[2] = { &route.source, &route.destination };
+                
+                for (const string* name : endpoints) {
+                    pair<string, unsigned long long>& station = stations[StationIndex::fold(*name)];
+                    if (station.first.empty()) station.first = *name;
+                    station.second += route.bookings + 1;
+                }
+            }
+            
+            vector<pair<string, unsigned long long>> ranked;
+            for (const auto& station : stations) ranked.push_back(station.second);
+            
+            shared_ptr<AutocompleteState> fresh = make_shared<AutocompleteState>();
+            fresh->engine = make_shared<const StationAutocomplete>(ranked);
+            fresh->catalogVersion = catalogVersion;
+            fresh->builtAt = chrono::steady_clock::now();
+            
+            state = fresh;
+            atomic_store(&autocompleteState, state);
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+        }
+        
+        return state;
+    }
+    
+    // Reload every train into the catalog
+    void refreshCatalog() {
+        unsigned long long loadedVersion = trainCatalog.currentVersion();
+        
+        try {
+            trainCatalog.publish(trainRepository->getAllTrains(), loadedVersion);
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+        }
+    }
+    
+    // Inventory entry for (train, date), loaded on first use and reconciled once stale
+    SeatInventory::Entry* getInventoryEntry(int trainId, const string& journeyDate) {
+        static atomic<uint64_t>& hitCount = Metrics::cacheRequests("seat_inventory", true);
+        static atomic<uint64_t>& missCount = Metrics::cacheRequests("seat_inventory", false);
+        
+        SeatInventory::Entry* entry = seatInventory.find(trainId, journeyDate);
+        if (entry && !seatInventory.isStale(entry)) {
+            hitCount.fetch_add(1, memory_order_relaxed);
+            return entry;
+        }
+        
+        missCount.fetch_add(1, memory_order_relaxed);
+        
+        unsigned long long seenVersion = entry ? entry->version.load() : 0;
+        vector<int> availableBySegment;
+        bool found = false;
+        
+        try {
+            found = trainRepository->countAvailableSeats(trainId, journeyDate, availableBySegment);
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+        }
+        
+        if (!found) {
+            return entry;
+        }
+        
+        if (entry) {
+            seatInventory.reconcile(entry, seenVersion, availableBySegment);
+            return entry;
+        }
+        
+        return seatInventory.load(trainId, journeyDate, availableBySegment);
+    }
+    
+    // Seat map for (train, date), built on first use from the seats already assigned
+    SeatAllocator::Entry* getSeatMapEntry(int trainId, const string& journeyDate) {
+        static atomic<uint64_t>& hitCount = Metrics::cacheRequests("seat_map", true);
+        static atomic<uint64_t>& missCount = Metrics::cacheRequests("seat_map", false);
+        
+        SeatAllocator::Entry* entry = seatAllocator.find(trainId, journeyDate);
+        if (entry) {
+            hitCount.fetch_add(1, memory_order_relaxed);
+            return entry;
+        }
+        
+        missCount.fetch_add(1, memory_order_relaxed);
+        
+        try {
+            int totalSeats = 0;
+            int stopCount = 2;
+            vector<SeatAssignment> assignments;
+            
+            if (!trainRepository->getSeatAssignments(trainId, journeyDate, totalSeats, stopCount, assignments)) {
+                return nullptr;
+            }
+            
+            SeatMap seats(totalSeats, stopCount - 1);
+            for (const auto& assignment : assignments) {
+                seats.markOccupied(assignment.seatNumber, assignment.fromStop, assignment.toStop);
+            }
+            
+            return seatAllocator.load(trainId, journeyDate, move(seats));
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            return nullptr;
+        }
+    }
+    
+public:
+    TrainManager(TrainRepository* repository, ThreadPool* queryExecutor = nullptr)
+        : trainRepository(repository), executor(queryExecutor) {}
+    
+    vector<Train> searchTrains(const string& source, const string& destination) {
+        static OperationMetrics& metrics = Metrics::operation("searchTrains");
+        OperationTimer timer(metrics);
+        
+        vector<Train> trains;
+        
+        // Answer from the in-memory station index when the catalog is loaded
+        if (!trainCatalog.isCurrent()) {
+            refreshCatalog();
+        }
+        if (trainCatalog.searchTrains(source, destination, trains)) {
+            return trains;
+        }
+        
+        try {
+            trains = trainRepository->searchTrains(source, destination);
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+        }
+        
+        return trains;
+    }
+    
+    vector<Train> getAllTrains() {
+        static OperationMetrics& metrics = Metrics::operation("getAllTrains");
+        OperationTimer timer(metrics);
+        
+        vector<Train> trains;
+        
+        try {
+            trains = trainRepository->getAllTrains();
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+        }
+        
+        return trains;
+    }
+    
+    // Served from the train catalog; storage is only hit on a stale catalog or an unknown ID
+    shared_ptr<const Train> getTrainById(int trainId) {
+        static OperationMetrics& metrics = Metrics::operation("getTrainById");
+        static atomic<uint64_t>& hitCount = Metrics::cacheRequests("train_catalog", true);
+        static atomic<uint64_t>& missCount = Metrics::cacheRequests("train_catalog", false);
+        OperationTimer timer(metrics);
+        
+        shared_ptr<const Train> train = trainCatalog.find(trainId);
+        if (train) {
+            hitCount.fetch_add(1, memory_order_relaxed);
+            return train;
+        }
+        
+        missCount.fetch_add(1, memory_order_relaxed);
+        
+        if (!trainCatalog.isCurrent()) {
+            refreshCatalog();
+            train = trainCatalog.find(trainId);
+            if (train) {
+                return train;
+            }
+        }
+        
+        // Possibly added since the catalog was loaded
+        try {
+            Train found;
+            if (trainRepository->findTrain(trainId, found)) {
+                train = make_shared<const Train>(found);
+                trainCatalog.add(train);
+            }
+            
+            return train;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return nullptr;
+        }
+    }
+    
+    // Everything a booking on (train, date) needs: the train, the seat count and the seat map.
+    // On a cold date the three lookups are independent, so with a query executor they run
+    // concurrently and cost one round trip of latency instead of three. nullptr if the
+    // train does not exist.
+    shared_ptr<const Train> prepareBooking(int trainId, const string& journeyDate) {
+        SeatInventory::Entry* inventoryEntry = seatInventory.find(trainId, journeyDate);
+        bool inventoryCold = !inventoryEntry || seatInventory.isStale(inventoryEntry);
+        bool seatMapCold = !seatAllocator.find(trainId, journeyDate);
+        
+        if (!executor || (!inventoryCold && !seatMapCold)) {
+            shared_ptr<const Train> train = getTrainById(trainId);
+            if (train) {
+                getInventoryEntry(trainId, journeyDate);
+                getSeatMapEntry(trainId, journeyDate);
+            }
+            return train;
+        }
+        
+        future<SeatInventory::Entry*> inventory;
+        future<SeatAllocator::Entry*> seatMap;
+        
+        if (inventoryCold) {
+            inventory = executor->submit([this, trainId, journeyDate]() {
+                return getInventoryEntry(trainId, journeyDate);
+            });
+        }
+        if (seatMapCold) {
+            seatMap = executor->submit([this, trainId, journeyDate]() {
+                return getSeatMapEntry(trainId, journeyDate);
+            });
+        }
+        
+        // The train lookup runs here, usually straight from the catalog
+        shared_ptr<const Train> train = getTrainById(trainId);
+        
+        if (inventory.valid()) inventory.wait();
+        if (seatMap.valid()) seatMap.wait();
+        
+        return train;
+    }
+    
+    // Top-k station names for a partially typed name, cheap enough to call on every keystroke
+    vector<string> completeStation(const string& prefix, size_t k = 5) {
+        static OperationMetrics& metrics = Metrics::operation("completeStation");
+        OperationTimer timer(metrics);
+        
+        shared_ptr<const AutocompleteState> state = atomic_load(&autocompleteState);
+        if (!autocompleteIsFresh(state)) {
+            state = rebuildAutocomplete();
+        }
+        
+        return state ? state->engine->complete(prefix, k) : vector<string>();
+    }
+    
+    // Journeys with up to maxTransfers changes, planned over the cached timetable
+    vector<Journey> planJourneys(const string& source, const string& destination, int departAfter, int maxTransfers) {
+        static OperationMetrics& metrics = Metrics::operation("planJourneys");
+        OperationTimer timer(metrics);
+        
+        vector<Journey> journeys;
+        if (!trainCatalog.isCurrent()) {
+            refreshCatalog();
+        }
+        trainCatalog.planJourneys(source, destination, departAfter, maxTransfers, journeys);
+        return journeys;
+    }
+    
+    // Fares for a page of trains, from the compiled fare tables without storage access
+    vector<double> quoteFares(const vector<Train>& trains, const string& journeyDate, const vector<int>& passengerAges) {
+        static OperationMetrics& metrics = Metrics::operation("quoteFares");
+        OperationTimer timer(metrics);
+        
+        return fareEngine.quote(trains, journeyDate, passengerAges);
+    }
+    
+    // Fare on one train between two of its stops
+    double quoteFare(const Train& train, const string& journeyDate, const vector<int>& passengerAges,
+                     int fromStop = 0, int toStop = -1) {
+        static OperationMetrics& metrics = Metrics::operation("quoteFares");
+        OperationTimer timer(metrics);
+        
+        return fareEngine.quote(train, journeyDate, passengerAges, fromStop, toStop);
+    }
+    
+    // Call after the trains table changes so cached train details are reloaded
+    void invalidateTrainCache() {
+        trainCatalog.invalidate();
+    }
+    
+    // Seats free on every segment from fromStop to toStop (-1 for the final stop)
+    int getAvailableSeats(int trainId, const string& journeyDate, int fromStop = 0, int toStop = -1) {
+        static OperationMetrics& metrics = Metrics::operation("getAvailableSeats");
+        OperationTimer timer(metrics);
+        
+        SeatInventory::Entry* entry = getInventoryEntry(trainId, journeyDate);
+        return entry ? seatInventory.available(entry, fromStop, toStop) : 0;
+    }
+    
+    // Whole-route seats left for each train on each of days dates from firstDate: row t is
+    // trainIds[t], column d is firstDate + d days. Warm inventory entries answer directly;
+    // the rest come from one bulk query, which also loads them into the inventory.
+    vector<vector<int>> getAvailabilityCalendar(const vector<int>& trainIds, const string& firstDate, int days) {
+        static OperationMetrics& metrics = Metrics::operation("getAvailabilityCalendar");
+        static atomic<uint64_t>& hitCount = Metrics::cacheRequests("seat_inventory", true);
+        static atomic<uint64_t>& missCount = Metrics::cacheRequests("seat_inventory", false);
+        OperationTimer timer(metrics);
+        
+        vector<vector<int>> calendar(trainIds.size(), vector<int>(max(days, 0), 0));
+        long firstDay;
+        if (days <= 0 || !Utility::dayNumber(firstDate, firstDay)) {
+            return calendar;
+        }
+        
+        vector<string> dates;
+        for (int d = 0; d < days; d++) {
+            dates.push_back(Utility::dateFromDayNumber(firstDay + d));
+        }
+        
+        // Trains with any date not answered from memory, and the entry versions seen so far
+        vector<size_t> coldRows;
+        vector<unsigned long long> seenVersions;
+        for (size_t t = 0; t < trainIds.size(); t++) {
+            bool cold = false;
+            for (int d = 0; d < days; d++) {
+                SeatInventory::Entry* entry = seatInventory.find(trainIds[t], dates[d]);
+                if (entry && !seatInventory.isStale(entry)) {
+                    calendar[t][d] = seatInventory.available(entry, 0, -1);
+                } else {
+                    cold = true;
+                }
+            }
+            
+            if (cold) {
+                coldRows.push_back(t);
+                for (int d = 0; d < days; d++) {
+                    SeatInventory::Entry* entry = seatInventory.find(trainIds[t], dates[d]);
+                    seenVersions.push_back(entry ? entry->version.load() : 0);
+                }
+            }
+        }
+        
+        hitCount.fetch_add((trainIds.size() - coldRows.size()) * days, memory_order_relaxed);
+        missCount.fetch_add(coldRows.size() * days, memory_order_relaxed);
+        
+        if (coldRows.empty()) {
+            return calendar;
+        }
+        
+        vector<int> coldTrainIds;
+        for (size_t row : coldRows) coldTrainIds.push_back(trainIds[row]);
+        
+        vector<vector<int>> availableBySegment;
+        try {
+            trainRepository->countAvailableSeatsForDates(coldTrainIds, dates, availableBySegment);
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return calendar;
+        }
+        
+        for (size_t i = 0; i < coldRows.size(); i++) {
+            for (int d = 0; d < days; d++) {
+                size_t cell = i * days + d;
+                if (availableBySegment[cell].empty()) continue;
+                
+                int trainId = coldTrainIds[i];
+                SeatInventory::Entry* entry = seatInventory.find(trainId, dates[d]);
+                if (!entry) {
+                    entry = seatInventory.load(trainId, dates[d], availableBySegment[cell]);
+                } else if (seatInventory.isStale(entry)) {
+                    seatInventory.reconcile(entry, seenVersions[cell], availableBySegment[cell]);
+                }
+                calendar[coldRows[i]][d] = seatInventory.available(entry, 0, -1);
+            }
+        }
+        
+        return calendar;
+    }
+    
+    // Take seats from the in-memory inventory for the segments between two stops
+    bool reserveSeats(int trainId, const string& journeyDate, int numSeats, int fromStop = 0, int toStop = -1) {
+        SeatInventory::Entry* entry = getInventoryEntry(trainId, journeyDate);
+        return entry && seatInventory.tryReserve(entry, numSeats, fromStop, toStop);
+    }
+    
+    // Never loads or reconciles the entry: the caller has already written the change, so
+    // fresh database counts include these seats and adding them again would oversell
+    void releaseSeats(int trainId, const string& journeyDate, int numSeats, int fromStop = 0, int toStop = -1) {
+        SeatInventory::Entry* entry = seatInventory.find(trainId, journeyDate);
+        if (!entry) {
+            return;
+        }
+        
+        shared_ptr<const Train> train = getTrainById(trainId);
+        seatInventory.release(entry, numSeats, fromStop, toStop, train ? train->getTotalSeats() : INT_MAX);
+    }
+    
+    // Pick concrete seats for a group; empty if the seat map has no room
+    vector<string> allocateSeats(int trainId, const string& journeyDate, int numSeats, int fromStop = 0, int toStop = -1) {
+        SeatAllocator::Entry* entry = getSeatMapEntry(trainId, journeyDate);
+        if (!entry) {
+            return vector<string>();
+        }
+        
+        lock_guard<mutex> lock(entry->mtx);
+        return entry->seats.allocate(numSeats, fromStop, toStop);
+    }
+    
+    void freeSeats(int trainId, const string& journeyDate, const vector<string>& seatNumbers,
+                   int fromStop = 0, int toStop = -1) {
+        SeatAllocator::Entry* entry = seatAllocator.find(trainId, journeyDate);
+        if (entry) {
+            lock_guard<mutex> lock(entry->mtx);
+            entry->seats.release(seatNumbers, fromStop, toStop);
+        }
+    }
+};
+
+// ============= BOOKING CLASSES =============
+class Passenger {
+private:
+    int passengerId;
+    string passengerName;
+    int age;
+    string gender;
+    string seatNumber;
+
+public:
+    Passenger() : passengerId(0), passengerName(""), age(0), gender(""), seatNumber("") {}
+    
+    Passenger(int id, string name, int age, string gender, string seat = "")
+        : passengerId(id), passengerName(name), age(age), gender(gender), seatNumber(seat) {}
+    
+    // Getters
+    int getPassengerId() const { return passengerId; }
+    string getPassengerName() const { return passengerName; }
+    int getAge() const { return age; }
+    string getGender() const { return gender; }
+    string getSeatNumber() const { return seatNumber; }
+    
+    // Setters
+    void setPassengerId(int id) { passengerId = id; }
+    void setPassengerName(const string& name) { passengerName = name; }
+    void setAge(int a) { age = a; }
+    void setGender(const string& g) { gender = g; }
+    void setSeatNumber(const string& seat) { seatNumber = seat; }
+    
+    void displayInfo() const {
+        cout << left << setw(5) << passengerId
+             << setw(25) << passengerName
+             << setw(5) << age
+             << setw(10) << gender
+             << setw(10) << seatNumber << endl;
+    }
+    
+    static void displayHeader() {
+        cout << left << setw(5) << "ID"
+             << setw(25) << "Name"
+             << setw(5) << "Age"
+             << setw(10) << "Gender"
+             << setw(10) << "Seat" << endl;
+        cout << string(55, '-') << endl;
+    }
+};
+
+class Booking {
+private:
+    int bookingId;
+    int userId;
+    int trainId;
+    string bookingDate;
+    string journeyDate;
+    int numPassengers;
+    double totalFare;
+    string bookingStatus;
+    string paymentStatus;
+    vector<Passenger> passengers;
+    int fromStop; // Stop indexes on the train's route; toStop -1 is the final stop
+    int toStop;
+    string bookingKey; // Set by the writer before the booking has an ID; empty if none
+
+public:
+    Booking() : bookingId(0), userId(0), trainId(0), bookingDate(""), journeyDate(""),
+                numPassengers(0), totalFare(0.0), bookingStatus(""), paymentStatus(""),
+                fromStop(0), toStop(-1) {}
+    
+    Booking(int bookId, int usrId, int trnId, string bookDate, string jrnyDate,
+            int numPass, double fare, string bookStatus, string payStatus)
+        : bookingId(bookId), userId(usrId), trainId(trnId), bookingDate(bookDate),
+          journeyDate(jrnyDate), numPassengers(numPass), totalFare(fare),
+          bookingStatus(bookStatus), paymentStatus(payStatus), fromStop(0), toStop(-1) {}
+    
+    // Getters
+    int getBookingId() const { return bookingId; }
+    int getUserId() const { return userId; }
+    int getTrainId() const { return trainId; }
+    string getBookingDate() const { return bookingDate; }
+    string getJourneyDate() const { return journeyDate; }
+    int getNumPassengers() const { return numPassengers; }
+    double getTotalFare() const { return totalFare; }
+    string getBookingStatus() const { return bookingStatus; }
+    string getPaymentStatus() const { return paymentStatus; }
+    vector<Passenger> getPassengers() const { return passengers; }
+    int getFromStop() const { return fromStop; }
+    int getToStop() const { return toStop; }
+    string getBookingKey() const { return bookingKey; }
+    
+    // Setters
+    void setBookingId(int id) { bookingId = id; }
+    void setUserId(int id) { userId = id; }
+    void setTrainId(int id) { trainId = id; }
+    void setBookingDate(const string& date) { bookingDate = date; }
+    void setJourneyDate(const string& date) { journeyDate = date; }
+    void setNumPassengers(int num) { numPassengers = num; }
+    void setTotalFare(double fare) { totalFare = fare; }
+    void setBookingStatus(const string& status) { bookingStatus = status; }
+    void setPaymentStatus(const string& status) { paymentStatus = status; }
+    void setStops(int from, int to) { fromStop = from; toStop = to; }
+    void setBookingKey(const string& key) { bookingKey = key; }
+    
+    void addPassenger(const Passenger& passenger) {
+        passengers.push_back(passenger);
+    }
+    
+    void assignPassengerIds(const vector<int>& passengerIds) {
+        for (size_t i = 0; i < passengers.size() && i < passengerIds.size(); i++) {
+            passengers[i].setPassengerId(passengerIds[i]);
+        }
+    }
+    
+    void assignSeats(const vector<string>& seatNumbers) {
+        for (size_t i = 0; i < passengers.size() && i < seatNumbers.size(); i++) {
+            passengers[i].setSeatNumber(seatNumbers[i]);
+        }
+    }
+    
+    void displayInfo(const Train& train) const {
+        cout << "\n====== Booking Details ======\n";
+        cout << "Booking ID: " << bookingId << endl;
+        cout << "Booking Date: " << bookingDate << endl;
+        cout << "Journey Date: " << journeyDate << endl;
+        cout << "Train: " << train.getTrainName() << " (" << train.getTrainNumber() << ")" << endl;
+        TrainStop boarding = train.getStop(fromStop);
+        TrainStop alighting = train.getStop(toStop);
+        cout << "From: " << boarding.station << " To: " << alighting.station << endl;
+        cout << "Departure: " << boarding.departureTime << " Arrival: " << alighting.arrivalTime << endl;
+        cout << "Number of Passengers: " << numPassengers << endl;
+        cout << "Total Fare: $" << fixed << setprecision(2) << totalFare << endl;
+        cout << "Booking Status: " << bookingStatus << endl;
+        cout << "Payment Status: " << paymentStatus << endl;
+        
+        cout << "\n------ Passenger Details ------\n";
+        Passenger::displayHeader();
+        for (const auto& passenger : passengers) {
+            passenger.displayInfo();
+        }
+    }
+};
+
+// Storage operations behind BookingManager; see STORAGE BACKENDS for implementations
+class PassengerRepository {
+public:
+    virtual ~PassengerRepository() {}
+    
+    // Store (booking ID, passenger) rows atomically; returns the generated IDs in input order
+    virtual vector<int> insertPassengers(const vector<pair<int, Passenger>>& rows) = 0;
+};
+
+class BookingRepository {
+public:
+    virtual ~BookingRepository() {}
+    
+    // Store the booking and its passengers atomically; sets the booking and passenger IDs
+    virtual void insertBooking(Booking& booking) = 0;
+    
+    // Set the status to Cancelled if it is still currentStatus; false if the status has
+    // changed since it was read or the booking does not exist
+    virtual bool markCancelled(int bookingId, const string& currentStatus) = 0;
+    
+    virtual void updatePaymentStatus(int bookingId, const string& status) = 0;
+    
+    // Same status for many bookings at once, atomically
+    virtual void updatePaymentStatuses(const vector<int>& bookingIds, const string& status) = 0;
+    
+    // Newest first, each with its passengers
+    virtual vector<Booking> findUserBookings(int userId) = 0;
+    virtual bool findBooking(int bookingId, Booking& booking) = 0;
+    
+    // ID of the booking stored with this booking key; false if there is none
+    virtual bool findBookingByKey(const string& bookingKey, int& bookingId) = 0;
+    
+    // Waiting bookings on (train, date) in booking ID order, each with its passengers
+    virtual vector<Booking> findWaitingBookings(int trainId, const string& journeyDate) = 0;
+    
+    // Confirm a waiting booking and give its passengers these seats, in passenger ID order;
+    // false if it is no longer waiting
+    virtual bool confirmWaiting(int bookingId, const vector<string>& seatNumbers) = 0;
+};
+
+// Thrown by a journaled BookingRepository when a booking is safe in the local journal but
+// not in the database yet; it is applied in the background and has no booking ID so far
+struct BookingDeferred {
+    unsigned long long sequence; // Journal reference
+    
+    BookingDeferred(unsigned long long seq) : sequence(seq) {}
+};
+
+class BookingManager {
+private:
+    BookingRepository* bookingRepository;
+    PassengerRepository* passengerRepository;
+    TrainManager* trainManager;
+    Waitlist waitlist;
+    
+    // Fare from the train's distance and class, each passenger's age and the journey date
+    double calculateFare(const Booking& booking) {
+        vector<int> passengerAges;
+        for (const auto& passenger : booking.getPassengers()) {
+            passengerAges.push_back(passenger.getAge());
+        }
+        
+        // Passengers without details pay full fare
+        if ((int)passengerAges.size() < booking.getNumPassengers()) {
+            passengerAges.resize(booking.getNumPassengers(), -1);
+        }
+        
+        shared_ptr<const Train> train = trainManager->getTrainById(booking.getTrainId());
+        if (!train) {
+            return 0.0;
+        }
+        
+        return trainManager->quoteFare(*train, booking.getJourneyDate(), passengerAges,
+                                       booking.getFromStop(), booking.getToStop());
+    }
+    
+    Waitlist::Waiter waiterFor(const Booking& booking) {
+        Waitlist::Waiter waiter;
+        waiter.bookingId = booking.getBookingId();
+        waiter.numPassengers = booking.getNumPassengers();
+        waiter.fromStop = booking.getFromStop();
+        waiter.toStop = booking.getToStop();
+        return waiter;
+    }
+    
+    // Waitlist for (train, date), loaded from storage on first use
+    Waitlist::Entry* getWaitlistEntry(int trainId, const string& journeyDate) {
+        Waitlist::Entry* entry = waitlist.find(trainId, journeyDate);
+        if (entry) {
+            return entry;
+        }
+        
+        try {
+            vector<Waitlist::Waiter> waiters;
+            for (const auto& booking : bookingRepository->findWaitingBookings(trainId, journeyDate)) {
+                waiters.push_back(waiterFor(booking));
+            }
+            
+            return waitlist.load(trainId, journeyDate, waiters);
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            return nullptr;
+        }
+    }
+    
+    // Give free seats to waiting bookings in queue order, stopping at the first one that does
+    // not fit so a large group is not starved by smaller ones behind it. Returns the
+    // booking IDs that were confirmed.
+    vector<int> promoteWaiting(int trainId, const string& journeyDate) {
+        vector<int> promoted;
+        
+        Waitlist::Entry* entry = getWaitlistEntry(trainId, journeyDate);
+        if (!entry) {
+            return promoted;
+        }
+        
+        lock_guard<mutex> lock(entry->mtx);
+        
+        while (const Waitlist::Waiter* head = Waitlist::head(entry)) {
+            Waitlist::Waiter waiter = *head;
+            
+            if (!trainManager->reserveSeats(trainId, journeyDate, waiter.numPassengers, waiter.fromStop, waiter.toStop)) {
+                break;
+            }
+            
+            vector<string> seatNumbers = trainManager->allocateSeats(
+                trainId, journeyDate, waiter.numPassengers, waiter.fromStop, waiter.toStop);
+            bool confirmed = false;
+            
+            if ((int)seatNumbers.size() == waiter.numPassengers) {
+                try {
+                    confirmed = bookingRepository->confirmWaiting(waiter.bookingId, seatNumbers);
+                } catch (sql::SQLException &e) {
+                    // Keep the booking at the head; the next cancellation retries it
+                    cout << "SQL Error: " << e.what() << endl;
+                    trainManager->freeSeats(trainId, journeyDate, seatNumbers, waiter.fromStop, waiter.toStop);
+                    trainManager->releaseSeats(trainId, journeyDate, waiter.numPassengers, waiter.fromStop, waiter.toStop);
+                    break;
+                }
+            }
+            
+            if (!confirmed) {
+                trainManager->freeSeats(trainId, journeyDate, seatNumbers, waiter.fromStop, waiter.toStop);
+                trainManager->releaseSeats(trainId, journeyDate, waiter.numPassengers, waiter.fromStop, waiter.toStop);
+                
+                // No seat assignment fits the group yet
+                if ((int)seatNumbers.size() != waiter.numPassengers) {
+                    break;
+                }
+            } else {
+                promoted.push_back(waiter.bookingId);
+            }
+            
+            // Confirmed now, or cancelled/confirmed by someone else meanwhile
+            Waitlist::remove(entry, waiter.bookingId);
+        }
+        
+        return promoted;
+    }
+    
+    // Store the booking as Waiting, without seats, and queue it
+    bool joinWaitlist(Booking& booking, OperationTimer& timer) {
+        booking.setBookingStatus("Waiting");
+        booking.setTotalFare(calculateFare(booking));
+        
+        try {
+            bookingRepository->insertBooking(booking);
+        } catch (const BookingDeferred& deferred) {
+            // Joins the queue when the waitlist is next loaded from the database
+            cout << "Waitlist request saved as journal reference " << deferred.sequence
+                 << "; it will be queued once the database has it.\n";
+            return true;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return false;
+        }
+        
+        Waitlist::Entry* entry = getWaitlistEntry(booking.getTrainId(), booking.getJourneyDate());
+        if (entry) {
+            lock_guard<mutex> lock(entry->mtx);
+            Waitlist::add(entry, waiterFor(booking));
+        }
+        
+        // Seats may have been freed since ours could not be reserved
+        vector<int> promoted = promoteWaiting(booking.getTrainId(), booking.getJourneyDate());
+        if (find(promoted.begin(), promoted.end(), booking.getBookingId()) != promoted.end()) {
+            try {
+                bookingRepository->findBooking(booking.getBookingId(), booking);
+            } catch (sql::SQLException &e) {
+                cout << "SQL Error: " << e.what() << endl;
+            }
+        }
+        
+        return true;
+    }
+    
+public:
+    BookingManager(BookingRepository* bookings, PassengerRepository* passengers, TrainManager* trainMgr)
+        : bookingRepository(bookings), passengerRepository(passengers), trainManager(trainMgr) {}
+    
+    // With waitlistIfFull, a booking that does not fit is stored as Waiting and confirmed
+    // when cancellations free enough seats
+    bool createBooking(Booking& booking, bool waitlistIfFull = false) {
+        static OperationMetrics& metrics = Metrics::operation("createBooking");
+        OperationTimer timer(metrics);
+        
+        // Load the train, seat count and seat map together rather than one after another
+        shared_ptr<const Train> train = trainManager->prepareBooking(booking.getTrainId(), booking.getJourneyDate());
+        if (!train) {
+            cout << "Invalid Train ID.\n";
+            return false;
+        }
+        
+        // Store concrete stop indexes, so the booking keeps its segments if stops are added later
+        int fromStop = booking.getFromStop();
+        int toStop = booking.getToStop() < 0 ? train->getStopCount() - 1 : booking.getToStop();
+        if (fromStop < 0 || fromStop >= toStop || toStop >= train->getStopCount()) {
+            cout << "Invalid stops for this train.\n";
+            return false;
+        }
+        booking.setStops(fromStop, toStop);
+        
+        // Take the seats up front so concurrent bookers cannot both get the last ones
+        if (!trainManager->reserveSeats(booking.getTrainId(), booking.getJourneyDate(), booking.getNumPassengers(),
+                                        fromStop, toStop)) {
+            if (waitlistIfFull && booking.getNumPassengers() <= train->getTotalSeats()) {
+                return joinWaitlist(booking, timer);
+            }
+            
+            int availableSeats = trainManager->getAvailableSeats(booking.getTrainId(), booking.getJourneyDate(), fromStop, toStop);
+            cout << "Sorry, only " << availableSeats << " seats are available for this train on the selected date.\n";
+            return false;
+        }
+        
+        vector<string> seatNumbers = trainManager->allocateSeats(
+            booking.getTrainId(), booking.getJourneyDate(), booking.getNumPassengers(), fromStop, toStop);
+        
+        if ((int)seatNumbers.size() != booking.getNumPassengers()) {
+            cout << "Sorry, no seat assignment is possible for this train on the selected date.\n";
+            trainManager->freeSeats(booking.getTrainId(), booking.getJourneyDate(), seatNumbers, fromStop, toStop);
+            trainManager->releaseSeats(booking.getTrainId(), booking.getJourneyDate(), booking.getNumPassengers(),
+                                       fromStop, toStop);
+            return false;
+        }
+        
+        booking.assignSeats(seatNumbers);
+        
+        try {
+            // Calculate fare
+            double fare = calculateFare(booking);
+            booking.setTotalFare(fare);
+            
+            bookingRepository->insertBooking(booking);
+            
+            return true;
+        } catch (const BookingDeferred& deferred) {
+            // The seats stay taken; the journal will store the booking
+            cout << "Booking saved as journal reference " << deferred.sequence
+                 << "; it will be confirmed once the database has it.\n";
+            return true;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            trainManager->freeSeats(booking.getTrainId(), booking.getJourneyDate(), seatNumbers, fromStop, toStop);
+            trainManager->releaseSeats(booking.getTrainId(), booking.getJourneyDate(), booking.getNumPassengers(),
+                                       fromStop, toStop);
+            return false;
+        }
+    }
+    
+    // Store the passengers of several existing bookings in one transaction
+    bool addPassengers(vector<Booking>& bookings) {
+        static OperationMetrics& metrics = Metrics::operation("addPassengers");
+        OperationTimer timer(metrics);
+        
+        vector<pair<int, Passenger>> rows;
+        for (const auto& booking : bookings) {
+            for (const auto& passenger : booking.getPassengers()) {
+                rows.push_back(make_pair(booking.getBookingId(), passenger));
+            }
+        }
+        
+        try {
+            vector<int> passengerIds = passengerRepository->insertPassengers(rows);
+            
+            size_t next = 0;
+            for (auto& booking : bookings) {
+                size_t count = booking.getPassengers().size();
+                booking.assignPassengerIds(vector<int>(passengerIds.begin() + next, passengerIds.begin() + next + count));
+                next += count;
+            }
+            
+            return true;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return false;
+        }
+    }
+    
+    bool cancelBooking(int bookingId) {
+        static OperationMetrics& metrics = Metrics::operation("cancelBooking");
+        OperationTimer timer(metrics);
+        
+        try {
+            // Only the call that actually cancelled the booking touches seats and the waitlist,
+            // and it does so for the status it cancelled. A waiting booking may be confirmed
+            // between the read and the update; read it again then. Statuses only move from
+            // Waiting to Confirmed to Cancelled, so this ends.
+            Booking booking;
+            do {
+                if (!bookingRepository->findBooking(bookingId, booking)) {
+                    return false;
+                }
+                if (booking.getBookingStatus() == "Cancelled") {
+                    return true;
+                }
+            } while (!bookingRepository->markCancelled(bookingId, booking.getBookingStatus()));
+            
+            if (booking.getBookingStatus() == "Confirmed") {
+                vector<string> seatNumbers;
+                for (const auto& passenger : booking.getPassengers()) {
+                    seatNumbers.push_back(passenger.getSeatNumber());
+                }
+                
+                trainManager->freeSeats(booking.getTrainId(), booking.getJourneyDate(), seatNumbers,
+                                        booking.getFromStop(), booking.getToStop());
+                trainManager->releaseSeats(booking.getTrainId(), booking.getJourneyDate(), booking.getNumPassengers(),
+                                           booking.getFromStop(), booking.getToStop());
+                promoteWaiting(booking.getTrainId(), booking.getJourneyDate());
+            } else if (booking.getBookingStatus() == "Waiting") {
+                Waitlist::Entry* entry = getWaitlistEntry(booking.getTrainId(), booking.getJourneyDate());
+                if (entry) {
+                    lock_guard<mutex> lock(entry->mtx);
+                    Waitlist::remove(entry, bookingId);
+                }
+                
+                // A group that was blocking the queue may have left it
+                promoteWaiting(booking.getTrainId(), booking.getJourneyDate());
+            }
+            
+            return true;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return false;
+        }
+    }
+    
+    bool updatePaymentStatus(int bookingId, const string& status) {
+        static OperationMetrics& metrics = Metrics::operation("updatePaymentStatus");
+        OperationTimer timer(metrics);
+        
+        try {
+            bookingRepository->updatePaymentStatus(bookingId, status);
+            return true;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return false;
+        }
+    }
+    
+    bool updatePaymentStatuses(const vector<int>& bookingIds, const string& status) {
+        static OperationMetrics& metrics = Metrics::operation("updatePaymentStatuses");
+        OperationTimer timer(metrics);
+        
+        try {
+            bookingRepository->updatePaymentStatuses(bookingIds, status);
+            return true;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return false;
+        }
+    }
+    
+    vector<Booking> getUserBookings(int userId) {
+        static OperationMetrics& metrics = Metrics::operation("getUserBookings");
+        OperationTimer timer(metrics);
+        
+        try {
+            return bookingRepository->findUserBookings(userId);
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return vector<Booking>();
+        }
+    }
+    
+    Booking* getBookingById(int bookingId) {
+        static OperationMetrics& metrics = Metrics::operation("getBookingById");
+        OperationTimer timer(metrics);
+        
+        try {
+            Booking booking;
+            if (bookingRepository->findBooking(bookingId, booking)) {
+                return new Booking(booking);
+            }
+            return nullptr;
+        } catch (sql::SQLException &e) {
+            cout << "SQL Error: " << e.what() << endl;
+            timer.fail();
+            return nullptr;
+        }
+    }
+};
+
+// ============= BOOKING JOURNAL =============
+// Append-only write-ahead log of booking and cancellation events on local disk, so an
+// acknowledged booking survives a database outage or a crash before it is committed.
+// Each record is [payload length u32][CRC-32 of payload u32][payload], little endian;
+// the payload starts with the record type and a sequence number. Recovery stops at the
+// first short or corrupt record (a torn final write) and truncates the file there.
+//
+// Callers queue encoded records and one writer thread flushes everything queued since
+// its previous pass with a single write and fsync, so concurrent bookings share the
+// cost of a sync (group commit). Once no event is outstanding the file is truncated.
+class BookingJournal {
+public:
+    enum RecordType { BookingRecord = 1, CancelRecord = 2, CompletedRecord = 3 };
+    
+    // An event that is durable in the journal but not yet known to be in the database
+    struct PendingEntry {
+        unsigned long long sequence;
+        RecordType type;
+        Booking booking; // BookingRecord
+        int bookingId;   // CancelRecord
+        string status;   // CancelRecord: the status being cancelled; empty in older journals
+        bool deferred;   // Left to the background applier instead of the caller
+    };
+    
+    // Thrown by the appends once the journal cannot take records: it never opened, or a
+    // write failed. Callers then go straight to the database.
+    struct Unavailable {};
+
+private:
+    string path;
+    int fd;
+    
+    mutable mutex mtx;
+    condition_variable workAvailable;
+    condition_variable durable;
+    string queued; // Encoded records waiting for the writer thread
+    unsigned long long nextSequence;
+    unsigned long long lastQueued;
+    unsigned long long lastDurable;
+    bool failed;
+    bool stopping;
+    bool compactRequested;
+    map<unsigned long long, PendingEntry> pending;
+    thread writer;
+    
+    // ----- Encoding -----
+    static uint32_t crc32(const string& data) {
+        static const vector<uint32_t> table = [] {
+            vector<uint32_t> entries(256);
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+                }
+                entries[i] = crc;
+            }
+            return entries;
+        }();
+        
+        uint32_t crc = 0xFFFFFFFFu;
+        for (unsigned char c : data) {
+            crc = table[(crc ^ c) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+    
+    static void putNumber(string& out, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++) {
+            out.push_back((char)((value >> (8 * i)) & 0xFF));
+        }
+    }
+    
+    static void putText(string& out, const string& text) {
+        putNumber(out, text.size(), 4);
+        out += text;
+    }
+    
+    // Bounds-checked decoder for one payload; ok turns false on the first overrun
+    struct RecordReader {
+        const string& data;
+        size_t pos;
+        bool ok;
+        
+        RecordReader(const string& data) : data(data), pos(0), ok(true) {}
+        
+        uint64_t number(size_t bytes) {
+            if (!ok || data.size() - pos < bytes) {
+                ok = false;
+                return 0;
+            }
+            
+            uint64_t value = 0;
+            for (size_t i = 0; i < bytes; i++) {
+                value |= (uint64_t)(unsigned char)data[pos + i] << (8 * i);
+            }
+            pos += bytes;
+            return value;
+        }
+        
+        string text() {
+            size_t length = (size_t)number(4);
+            if (!ok || data.size() - pos < length) {
+                ok = false;
+                return "";
+            }
+            
+            string value = data.substr(pos, length);
+            pos += length;
+            return value;
+        }
+    };
+    
+    static string encode(RecordType type, unsigned long long sequence, const Booking* booking, int bookingId,
+                         const string& status) {
+        string payload;
+        putNumber(payload, type, 1);
+        putNumber(payload, sequence, 8);
+        
+        if (type == BookingRecord) {
+            double fare = booking->getTotalFare();
+            uint64_t fareBits;
+            memcpy(&fareBits, &fare, sizeof(fareBits));
+            
+            putNumber(payload, (uint32_t)booking->getUserId(), 4);
+            putNumber(payload, (uint32_t)booking->getTrainId(), 4);
+            putText(payload, booking->getBookingDate());
+            putText(payload, booking->getJourneyDate());
+            putNumber(payload, (uint32_t)booking->getNumPassengers(), 4);
+            putNumber(payload, fareBits, 8);
+            putText(payload, booking->getBookingStatus());
+            putText(payload, booking->getPaymentStatus());
+            
+            vector<Passenger> passengers = booking->getPassengers();
+            putNumber(payload, passengers.size(), 4);
+            for (const auto& passenger : passengers) {
+                putText(payload, passenger.getPassengerName());
+                putNumber(payload, (uint32_t)passenger.getAge(), 4);
+                putText(payload, passenger.getGender());
+                putText(payload, passenger.getSeatNumber());
+            }
+            
+            // Appended after the passengers so journals written before stops existed still replay
+            putNumber(payload, (uint32_t)booking->getFromStop(), 4);
+            putNumber(payload, (uint32_t)booking->getToStop(), 4);
+            putText(payload, booking->getBookingKey());
+        } else if (type == CancelRecord) {
+            putNumber(payload, (uint32_t)bookingId, 4);
+            putText(payload, status);
+        }
+        
+        string record;
+        putNumber(record, payload.size(), 4);
+        putNumber(record, crc32(payload), 4);
+        return record + payload;
+    }
+    
+    // Apply one recovered payload to the pending set; false if it does not decode
+    bool replay(const string& payload) {
+        RecordReader reader(payload);
+        PendingEntry entry;
+        entry.type = (RecordType)reader.number(1);
+        entry.sequence = reader.number(8);
+        entry.bookingId = 0;
+        entry.deferred = true;
+        
+        if (entry.type == BookingRecord) {
+            Booking& booking = entry.booking;
+            booking.setUserId((int)(uint32_t)reader.number(4));
+            booking.setTrainId((int)(uint32_t)reader.number(4));
+            booking.setBookingDate(reader.text());
+            booking.setJourneyDate(reader.text());
+            booking.setNumPassengers((int)(uint32_t)reader.number(4));
+            
+            uint64_t fareBits = reader.number(8);
+            double fare;
+            memcpy(&fare, &fareBits, sizeof(fare));
+            booking.setTotalFare(fare);
+            
+            booking.setBookingStatus(reader.text());
+            booking.setPaymentStatus(reader.text());
+            
+            size_t count = (size_t)reader.number(4);
+            for (size_t i = 0; i < count && reader.ok; i++) {
+                string name = reader.text();
+                int age = (int)(uint32_t)reader.number(4);
+                string gender = reader.text();
+                string seat = reader.text();
+                booking.addPassenger(Passenger(0, name, age, gender, seat));
+            }
+            
+            if (reader.ok && reader.pos < payload.size()) {
+                int fromStop = (int)(uint32_t)reader.number(4);
+                int toStop = (int)(uint32_t)reader.number(4);
+                booking.setStops(fromStop, toStop);
+            }
+            if (reader.ok && reader.pos < payload.size()) {
+                booking.setBookingKey(reader.text());
+            }
+        } else if (entry.type == CancelRecord) {
+            entry.bookingId = (int)(uint32_t)reader.number(4);
+            if (reader.ok && reader.pos < payload.size()) {
+                entry.status = reader.text();
+            }
+        } else if (entry.type != CompletedRecord) {
+            return false;
+        }
+        
+        if (!reader.ok || reader.pos != payload.size()) {
+            return false;
+        }
+        
+        if (entry.type == CompletedRecord) {
+            pending.erase(entry.sequence);
+        } else {
+            pending[entry.sequence] = entry;
+        }
+        nextSequence = max(nextSequence, entry.sequence + 1);
+        return true;
+    }
+    
+    // Load outstanding events; returns the length of the intact prefix of the file
+    size_t recover(size_t& fileLength) {
+        ifstream in(path.c_str(), ios::binary);
+        string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        fileLength = data.size();
+        
+        size_t offset = 0;
+        while (data.size() - offset >= 8) {
+            RecordReader header(data);
+            header.pos = offset;
+            size_t length = (size_t)header.number(4);
+            uint32_t crc = (uint32_t)header.number(4);
+            
+            if (data.size() - offset - 8 < length) {
+                break;
+            }
+            
+            string payload = data.substr(offset + 8, length);
+            if (crc32(payload) != crc || !replay(payload)) {
+                break;
+            }
+            offset += 8 + length;
+        }
+        
+        return offset;
+    }
+    
+    // ----- File access -----
+    static int openFile(const string& path) {
+        #ifdef _WIN32
+            return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+        #else
+            return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        #endif
+    }
+    
+    static bool writeAll(int fd, const string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            #ifdef _WIN32
+                int n = _write(fd, data.data() + written, (unsigned int)(data.size() - written));
+            #else
+                ssize_t n = write(fd, data.data() + written, data.size() - written);
+                if (n < 0 && errno == EINTR) continue;
+            #endif
+            if (n <= 0) return false;
+            written += (size_t)n;
+        }
+        return true;
+    }
+    
+    static bool syncFile(int fd) {
+        #if defined(_WIN32)
+            return _commit(fd) == 0;
+        #elif defined(__linux__)
+            return fdatasync(fd) == 0;
+        #else
+            return fsync(fd) == 0;
+        #endif
+    }
+    
+    static bool truncateFile(int fd, size_t length) {
+        #ifdef _WIN32
+            return _chsize(fd, (long)length) == 0;
+        #else
+            return ftruncate(fd, (off_t)length) == 0;
+        #endif
+    }
+    
+    static void closeFile(int fd) {
+        #ifdef _WIN32
+            _close(fd);
+        #else
+            close(fd);
+        #endif
+    }
+    
+    // ----- Group commit -----
+    void writeLoop() {
+        static OperationMetrics& metrics = Metrics::operation("journalCommit");
+        
+        unique_lock<mutex> lock(mtx);
+        while (true) {
+            workAvailable.wait(lock, [this] { return !queued.empty() || compactRequested || stopping; });
+            
+            if (!queued.empty()) {
+                string batch;
+                batch.swap(queued);
+                unsigned long long batchEnd = lastQueued;
+                lock.unlock();
+                
+                bool written;
+                {
+                    OperationTimer timer(metrics);
+                    written = writeAll(fd, batch) && syncFile(fd);
+                    if (!written) timer.fail();
+                }
+                
+                lock.lock();
+                if (written) {
+                    lastDurable = batchEnd;
+                } else if (!failed) {
+                    failed = true;
+                    cout << "Journal Error: cannot write " << path << "; bookings go straight to the database" << endl;
+                }
+                durable.notify_all();
+            } else if (compactRequested) {
+                // Nothing outstanding means nothing in the file is needed any more
+                compactRequested = false;
+                if (pending.empty() && !failed) {
+                    truncateFile(fd, 0);
+                }
+            } else {
+                return;
+            }
+        }
+    }
+    
+    // Outstanding events are few, so a scan is fine
+    bool hasPendingCancelLocked(int bookingId) const {
+        for (const auto& item : pending) {
+            if (item.second.type == CancelRecord && item.second.bookingId == bookingId) return true;
+        }
+        return false;
+    }
+    
+    // Queue the record and wait until the writer has synced it
+    unsigned long long enqueue(unique_lock<mutex>& lock, PendingEntry entry) {
+        if (fd < 0 || failed) {
+            throw Unavailable();
+        }
+        
+        entry.sequence = nextSequence++;
+        entry.deferred = false;
+        queued += encode(entry.type, entry.sequence, &entry.booking, entry.bookingId, entry.status);
+        lastQueued = entry.sequence;
+        pending[entry.sequence] = entry;
+        workAvailable.notify_one();
+        
+        durable.wait(lock, [&] { return lastDurable >= entry.sequence || failed; });
+        if (lastDurable < entry.sequence) {
+            pending.erase(entry.sequence);
+            throw Unavailable();
+        }
+        
+        return entry.sequence;
+    }
+
+public:
+    BookingJournal(const string& journalPath)
+        : path(journalPath), fd(-1), nextSequence(1), lastQueued(0), lastDurable(0),
+          failed(false), stopping(false), compactRequested(false) {
+        size_t fileLength = 0;
+        size_t validLength = recover(fileLength);
+        
+        fd = openFile(path);
+        if (fd < 0) {
+            cout << "Journal Error: cannot open " << path << "; bookings go straight to the database" << endl;
+        } else if (validLength < fileLength) {
+            cout << "Journal: discarding " << (fileLength - validLength) << " bytes of incomplete records in " << path << endl;
+            truncateFile(fd, validLength);
+        }
+        
+        if (!pending.empty()) {
+            cout << "Journal: " << pending.size() << " event(s) from " << path << " will be replayed" << endl;
+        }
+        lastQueued = lastDurable = nextSequence - 1;
+        
+        writer = thread(&BookingJournal::writeLoop, this);
+    }
+    
+    ~BookingJournal() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        workAvailable.notify_one();
+        writer.join();
+        
+        if (fd >= 0) {
+            closeFile(fd);
+        }
+    }
+    
+    // Both appends return once the record is on disk, and throw Unavailable if it cannot
+    // be written
+    unsigned long long appendBooking(const Booking& booking) {
+        unique_lock<mutex> lock(mtx);
+        
+        PendingEntry entry;
+        entry.type = BookingRecord;
+        entry.booking = booking;
+        entry.bookingId = 0;
+        return enqueue(lock, entry);
+    }
+    
+    // 0 if a cancellation of this booking is already outstanding
+    unsigned long long appendCancel(int bookingId, const string& currentStatus) {
+        unique_lock<mutex> lock(mtx);
+        if (hasPendingCancelLocked(bookingId)) {
+            return 0;
+        }
+        
+        PendingEntry entry;
+        entry.type = CancelRecord;
+        entry.bookingId = bookingId;
+        entry.status = currentStatus;
+        return enqueue(lock, entry);
+    }
+    
+    // The event reached the database or can never be applied; no need to wait for the
+    // marker to be synced, since replaying a completed event is harmless
+    void complete(unsigned long long sequence) {
+        lock_guard<mutex> lock(mtx);
+        if (!pending.erase(sequence) || fd < 0 || failed) {
+            return;
+        }
+        
+        queued += encode(CompletedRecord, sequence, nullptr, 0, "");
+        if (pending.empty()) {
+            compactRequested = true;
+        }
+        workAvailable.notify_one();
+    }
+    
+    void defer(unsigned long long sequence) {
+        lock_guard<mutex> lock(mtx);
+        auto it = pending.find(sequence);
+        if (it != pending.end()) {
+            it->second.deferred = true;
+        }
+    }
+    
+    // Deferred events in journal order
+    vector<PendingEntry> deferredEntries() const {
+        lock_guard<mutex> lock(mtx);
+        vector<PendingEntry> entries;
+        for (const auto& item : pending) {
+            if (item.second.deferred) entries.push_back(item.second);
+        }
+        return entries;
+    }
+    
+    // Seats held by confirmed bookings that are not in the database yet
+    vector<SeatAssignment> pendingSeats(int trainId, const string& journeyDate) const {
+        string date = Utility::normalizeDate(journeyDate);
+        
+        lock_guard<mutex> lock(mtx);
+        vector<SeatAssignment> seats;
+        for (const auto& item : pending) {
+            const Booking& booking = item.second.booking;
+            if (item.second.type != BookingRecord || booking.getBookingStatus() != "Confirmed" ||
+                booking.getTrainId() != trainId ||
+                Utility::normalizeDate(booking.getJourneyDate()) != date) {
+                continue;
+            }
+            
+            for (const auto& passenger : booking.getPassengers()) {
+                SeatAssignment seat = { passenger.getSeatNumber(), booking.getFromStop(), booking.getToStop() };
+                seats.push_back(seat);
+            }
+        }
+        return seats;
+    }
+    
+    bool hasPendingCancel(int bookingId) const {
+        lock_guard<mutex> lock(mtx);
+        return hasPendingCancelLocked(bookingId);
+    }
+};
+
+// BookingRepository that writes each booking and cancellation to the journal before the
+// database. An event that fails for a transient reason (lost connection, pool timeout,
+// lock wait) stays in the journal and a background thread applies it, in journal order,
+// retrying with backoff; insertBooking then throws BookingDeferred instead of an error.
+// With applyAsync every event is left to that thread, so bookings are acknowledged at
+// journal latency during bursts.
+class JournaledBookingRepository : public BookingRepository {
+private:
+    BookingRepository* bookingRepository;
+    TrainRepository* trainRepository; // The database's view, without journaled seats
+    BookingJournal* journal;
+    bool applyAsync;
+    
+    const chrono::milliseconds minRetryDelay = chrono::milliseconds(100);
+    const chrono::milliseconds maxRetryDelay = chrono::milliseconds(5000);
+    
+    mutex applierMutex;
+    condition_variable applierWake;
+    bool applierWoken;
+    atomic<bool> stopping;
+    thread applier;
+    
+    // Driver-side errors (code 0, which includes the pool timeout), client connection
+    // errors (2000 and up), lock wait timeouts and deadlocks; anything else would fail again
+    static bool isTransient(const sql::SQLException& e) {
+        int code = e.getErrorCode();
+        return code == 0 || code >= 2000 || code == 1205 || code == 1213;
+    }
+    
+    // A replayed booking may have committed just before a crash lost its completion
+    // marker; its booking key is then already in the database
+    bool alreadyStored(const Booking& booking) {
+        int bookingId;
+        if (!booking.getBookingKey().empty()) {
+            return bookingRepository->findBookingByKey(booking.getBookingKey(), bookingId);
+        }
+        
+        // Records journaled before booking keys existed: a confirmed booking whose seats are
+        // held between the same stops. A waiting one cannot be told apart.
+        int totalSeats = 0;
+        int stopCount = 2;
+        vector<SeatAssignment> held;
+        if (booking.getBookingStatus() != "Confirmed" || booking.getPassengers().empty() ||
+            !trainRepository->getSeatAssignments(booking.getTrainId(), booking.getJourneyDate(),
+                                                 totalSeats, stopCount, held)) {
+            return false;
+        }
+        
+        unordered_set<string> heldSeats;
+        for (const auto& seat : held) {
+            if (seat.fromStop == booking.getFromStop() && seat.toStop == booking.getToStop()) {
+                heldSeats.insert(seat.seatNumber);
+            }
+        }
+        for (const auto& passenger : booking.getPassengers()) {
+            if (!heldSeats.count(passenger.getSeatNumber())) return false;
+        }
+        return true;
+    }
+    
+    // False if the database is still unreachable
+    bool apply(const BookingJournal::PendingEntry& entry) {
+        try {
+            if (entry.type == BookingJournal::CancelRecord) {
+                // Older journals did not record the status; cancel whatever is stored
+                Booking booking;
+                string status = entry.status;
+                if (status.empty() && bookingRepository->findBooking(entry.bookingId, booking)) {
+                    status = booking.getBookingStatus();
+                }
+                if (status != "Cancelled") {
+                    bookingRepository->markCancelled(entry.bookingId, status);
+                }
+            } else if (!alreadyStored(entry.booking)) {
+                Booking booking = entry.booking;
+                bookingRepository->insertBooking(booking);
+            }
+        } catch (sql::SQLException &e) {
+            if (isTransient(e)) {
+                return false;
+            }
+            cout << "Journal Error: dropping event " << entry.sequence << ": " << e.what() << endl;
+        }
+        
+        journal->complete(entry.sequence);
+        return true;
+    }
+    
+    void applyLoop() {
+        chrono::milliseconds retryDelay = minRetryDelay;
+        bool caughtUp = false;
+        
+        unique_lock<mutex> lock(applierMutex);
+        while (true) {
+            auto woken = [this] { return applierWoken || stopping; };
+            if (caughtUp) {
+                applierWake.wait(lock, woken);
+            } else {
+                applierWake.wait_for(lock, retryDelay, woken);
+            }
+            if (stopping) {
+                return;
+            }
+            applierWoken = false;
+            lock.unlock();
+            
+            caughtUp = true;
+            for (const auto& entry : journal->deferredEntries()) {
+                if (stopping || !apply(entry)) {
+                    caughtUp = false;
+                    break;
+                }
+            }
+            
+            lock.lock();
+            retryDelay = caughtUp ? minRetryDelay : min(retryDelay * 2, maxRetryDelay);
+        }
+    }
+    
+    void defer(unsigned long long sequence) {
+        journal->defer(sequence);
+        
+        lock_guard<mutex> lock(applierMutex);
+        applierWoken = true;
+        applierWake.notify_one();
+    }
+    
+    // Show an outstanding cancellation as already done
+    void overlayPendingCancel(Booking& booking) {
+        if (journal->hasPendingCancel(booking.getBookingId())) {
+            booking.setBookingStatus("Cancelled");
+        }
+    }
+
+public:
+    JournaledBookingRepository(BookingRepository* bookings, TrainRepository* trains,
+                               BookingJournal* bookingJournal, bool async)
+        : bookingRepository(bookings), trainRepository(trains), journal(bookingJournal),
+          applyAsync(async), applierWoken(true), stopping(false) {
+        // Starts by replaying whatever the journal recovered
+        applier = thread(&JournaledBookingRepository::applyLoop, this);
+    }
+    
+    ~JournaledBookingRepository() {
+        {
+            lock_guard<mutex> lock(applierMutex);
+            stopping = true;
+        }
+        applierWake.notify_one();
+        applier.join();
+    }
+    
+    void insertBooking(Booking& booking) override {
+        // Lets a replay find the booking if it reached the database without being marked complete
+        if (booking.getBookingKey().empty()) {
+            booking.setBookingKey(Utility::randomKey());
+        }
+        
+        unsigned long long sequence;
+        try {
+            sequence = journal->appendBooking(booking);
+        } catch (const BookingJournal::Unavailable&) {
+            bookingRepository->insertBooking(booking);
+            return;
+        }
+        
+        if (!applyAsync) {
+            try {
+                bookingRepository->insertBooking(booking);
+                journal->complete(sequence);
+                return;
+            } catch (sql::SQLException &e) {
+                if (!isTransient(e)) {
+                    journal->complete(sequence);
+                    throw;
+                }
+                cout << "SQL Error: " << e.what() << endl;
+            }
+        }
+        
+        booking.setBookingId(0);
+        defer(sequence);
+        throw BookingDeferred(sequence);
+    }
+    
+    bool markCancelled(int bookingId, const string& currentStatus) override {
+        unsigned long long sequence;
+        try {
+            sequence = journal->appendCancel(bookingId, currentStatus);
+        } catch (const BookingJournal::Unavailable&) {
+            return bookingRepository->markCancelled(bookingId, currentStatus);
+        }
+        
+        if (sequence == 0) {
+            return false;
+        }
+        
+        if (!applyAsync) {
+            try {
+                bool cancelled = bookingRepository->markCancelled(bookingId, currentStatus);
+                journal->complete(sequence);
+                return cancelled;
+            } catch (sql::SQLException &e) {
+                if (!isTransient(e)) {
+                    journal->complete(sequence);
+                    throw;
+                }
+                cout << "SQL Error: " << e.what() << endl;
+            }
+        }
+        
+        // No other cancellation is outstanding, and confirmWaiting leaves the booking alone
+        // until this one is applied, so the status the caller read still holds
+        defer(sequence);
+        return true;
+    }
+    
+    void updatePaymentStatus(int bookingId, const string& status) override {
+        bookingRepository->updatePaymentStatus(bookingId, status);
+    }
+    
+    void updatePaymentStatuses(const vector<int>& bookingIds, const string& status) override {
+        bookingRepository->updatePaymentStatuses(bookingIds, status);
+    }
+    
+    vector<Booking> findUserBookings(int userId) override {
+        vector<Booking> bookings = bookingRepository->findUserBookings(userId);
+        for (auto& booking : bookings) {
+            overlayPendingCancel(booking);
+        }
+        return bookings;
+    }
+    
+    bool findBooking(int bookingId, Booking& booking) override {
+        if (!bookingRepository->findBooking(bookingId, booking)) {
+            return false;
+        }
+        
+        overlayPendingCancel(booking);
+        return true;
+    }
+    
+    bool findBookingByKey(const string& bookingKey, int& bookingId) override {
+        return bookingRepository->findBookingByKey(bookingKey, bookingId);
+    }
+    
+    vector<Booking> findWaitingBookings(int trainId, const string& journeyDate) override {
+        return bookingRepository->findWaitingBookings(trainId, journeyDate);
+    }
+    
+    bool confirmWaiting(int bookingId, const vector<string>& seatNumbers) override {
+        if (journal->hasPendingCancel(bookingId)) {
+            return false;
+        }
+        return bookingRepository->confirmWaiting(bookingId, seatNumbers);
+    }
+};
+
+// TrainRepository that treats seats of journaled bookings not yet in the database as
+// taken, so seat counts and seat maps loaded from the database do not sell them again.
+// A booking that has just committed but is not marked complete yet counts twice for a
+// moment, which only under-reports availability.
+class JournaledTrainRepository : public TrainRepository {
+private:
+    TrainRepository* trainRepository;
+    BookingJournal* journal;
+
+public:
+    JournaledTrainRepository(TrainRepository* trains, BookingJournal* bookingJournal)
+        : trainRepository(trains), journal(bookingJournal) {}
+    
+    vector<Train> getAllTrains() override {
+        return trainRepository->getAllTrains();
+    }
+    
+    bool findTrain(int trainId, Train& train) override {
+        return trainRepository->findTrain(trainId, train);
+    }
+    
+    vector<Train> searchTrains(const string& source, const string& destination) override {
+        return trainRepository->searchTrains(source, destination);
+    }
+    
+    bool countAvailableSeats(int trainId, const string& journeyDate, vector<int>& availableBySegment) override {
+        if (!trainRepository->countAvailableSeats(trainId, journeyDate, availableBySegment)) {
+            return false;
+        }
+        
+        for (const auto& seat : journal->pendingSeats(trainId, journeyDate)) {
+            takeSeats(availableBySegment, seat.fromStop, seat.toStop, 1);
+        }
+        for (auto& available : availableBySegment) {
+            available = max(0, available);
+        }
+        return true;
+    }
+    
+    void countAvailableSeatsForDates(const vector<int>& trainIds, const vector<string>& journeyDates,
+                                     vector<vector<int>>& availableBySegment) override {
+        trainRepository->countAvailableSeatsForDates(trainIds, journeyDates, availableBySegment);
+        
+        for (size_t t = 0; t < trainIds.size(); t++) {
+            for (size_t d = 0; d < journeyDates.size(); d++) {
+                vector<int>& cell = availableBySegment[t * journeyDates.size() + d];
+                if (cell.empty()) continue;
+                
+                for (const auto& seat : journal->pendingSeats(trainIds[t], journeyDates[d])) {
+                    takeSeats(cell, seat.fromStop, seat.toStop, 1);
+                }
+                for (auto& available : cell) {
+                    available = max(0, available);
+                }
+            }
+        }
+    }
+    
+    bool getSeatAssignments(int trainId, const string& journeyDate, int& totalSeats,
+                            int& stopCount, vector<SeatAssignment>& seats) override {
+        if (!trainRepository->getSeatAssignments(trainId, journeyDate, totalSeats, stopCount, seats)) {
+            return false;
+        }
+        
+        vector<SeatAssignment> pendingSeats = journal->pendingSeats(trainId, journeyDate);
+        seats.insert(seats.end(), pendingSeats.begin(), pendingSeats.end());
+        return true;
+    }
+    
+    vector<RouteBookingCount> getRouteBookingCounts() override {
+        return trainRepository->getRouteBookingCounts();
+    }
+};
+
+// ============= STORAGE BACKENDS =============
+// The repositories a set of managers runs against
+class StorageBackend {
+public:
+    virtual ~StorageBackend() {}
+    
+    virtual UserRepository* users() = 0;
+    virtual TrainRepository* trains() = 0;
+    virtual BookingRepository* bookings() = 0;
+    virtual PassengerRepository* passengers() = 0;
+    
+    // Pool for overlapping independent repository calls, or nullptr when calls are
+    // cheap enough to run inline
+    virtual ThreadPool* queryExecutor() { return nullptr; }
+};
+
+// ----- MySQL -----
+class MySqlUserRepository : public UserRepository {
+private:
+    DatabaseConnector* dbConnector;
+
+public:
+    MySqlUserRepository(DatabaseConnector* connector) : dbConnector(connector) {}
+    
+    void insertUser(User& user) override {
+        static OperationMetrics& metrics = Metrics::query("insertUser");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getConnection();
+        PreparedStatementHandle pstmt = con.prepare(
+            "INSERT INTO users(username, password, full_name, email, phone) VALUES(?, ?, ?, ?, ?)");
+        
+        pstmt->setString(1, user.getUsername());
+        pstmt->setString(2, user.getPassword());
+        pstmt->setString(3, user.getName());
+        pstmt->setString(4, user.getEmail());
+        pstmt->setString(5, user.getPhone());
+        
+        pstmt->executeUpdate();
+        
+        // Get the user ID of the newly registered user
+        sql::Statement* stmt = con->createStatement();
+        sql::ResultSet* res = stmt->executeQuery("SELECT LAST_INSERT_ID() as id");
+        
+        if (res->next()) {
+            user.setUserId(res->getInt("id"));
+        }
+        
+        delete stmt;
+        delete res;
+    }
+    
+    User* findUserByCredentials(const string& username, const string& password) override {
+        static OperationMetrics& metrics = Metrics::query("findUserByCredentials");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getConnection();
+        PreparedStatementHandle pstmt = con.prepare(
+            "SELECT * FROM users WHERE username = ? AND password = ?");
+        
+        pstmt->setString(1, username);
+        pstmt->setString(2, password);
+        
+        sql::ResultSet* res = pstmt->executeQuery();
+        
+        User* user = nullptr;
+        if (res->next()) {
+            user = new User(
+                res->getInt("user_id"),
+                res->getString("username"),
+                res->getString("password"),
+                res->getString("full_name"),
+                res->getString("email"),
+                res->getString("phone"),
+                res->getString("registration_date")
+            );
+        }
+        
+        delete res;
+        
+        return user;
+    }
+    
+    void updateUser(const User& user) override {
+        static OperationMetrics& metrics = Metrics::query("updateUser");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getConnection();
+        PreparedStatementHandle pstmt = con.prepare(
+            "UPDATE users SET full_name = ?, email = ?, phone = ? WHERE user_id = ?"
+        );
+        
+        pstmt->setString(1, user.getName());
+        pstmt->setString(2, user.getEmail());
+        pstmt->setString(3, user.getPhone());
+        pstmt->setInt(4, user.getUserId());
+        
+        pstmt->executeUpdate();
+    }
+    
+    void updatePassword(int userId, const string& newPassword) override {
+        static OperationMetrics& metrics = Metrics::query("updatePassword");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getConnection();
+        PreparedStatementHandle pstmt = con.prepare(
+            "UPDATE users SET password = ? WHERE user_id = ?"
+        );
+        
+        pstmt->setString(1, newPassword);
+        pstmt->setInt(2, userId);
+        
+        pstmt->executeUpdate();
+    }
+};
+
+// Timetable reads go to a read replica when one is configured. Seat counts stay on the
+// primary: they seed the seat inventory, which must not start out behind the bookings.
+class MySqlTrainRepository : public TrainRepository {
+private:
+    DatabaseConnector* dbConnector;
+    
+    static Train trainFromRow(sql::ResultSet* res) {
+        return Train(
+            res->getInt("train_id"),
+            res->getString("train_name"),
+            res->getString("train_number"),
+            res->getString("source"),
+            res->getString("destination"),
+            res->getString("departure_time"),
+            res->getString("arrival_time"),
+            res->getInt("total_seats")
+        );
+    }
+    
+    static string timeOrEmpty(sql::ResultSet* res, const string& column) {
+        return res->isNull(column) ? "" : res->getString(column);
+    }
+    
+    // Fill in routes from train_stops, one query for the lot; trains without rows run nonstop
+    void loadStops(PooledConnection& con, vector<Train>& trains) {
+        if (trains.empty()) {
+            return;
+        }
+        
+        unordered_map<int, vector<TrainStop>> routes;
+        string query = "SELECT train_id, station, arrival_time, departure_time FROM train_stops ";
+        if (trains.size() == 1) {
+            query += "WHERE train_id = " + to_string(trains.front().getTrainId()) + " ";
+        }
+        
+        sql::Statement* stmt = con->createStatement();
+        sql::ResultSet* res = stmt->executeQuery(query + "ORDER BY train_id, stop_sequence");
+        
+        while (res->next()) {
+            TrainStop stop = { res->getString("station"), timeOrEmpty(res, "arrival_time"),
+                               timeOrEmpty(res, "departure_time") };
+            routes[res->getInt("train_id")].push_back(stop);
+        }
+        
+        delete stmt;
+        delete res;
+        
+        for (auto& train : trains) {
+            auto it = routes.find(train.getTrainId());
+            if (it != routes.end() && it->second.size() >= 2) {
+                train.setStops(it->second);
+            }
+        }
+    }
+
+public:
+    MySqlTrainRepository(DatabaseConnector* connector) : dbConnector(connector) {}
+    
+    vector<Train> getAllTrains() override {
+        static OperationMetrics& metrics = Metrics::query("getAllTrains");
+        OperationTimer timer(metrics);
+        
+        vector<Train> trains;
+        
+        PooledConnection con = dbConnector->getReadConnection();
+        sql::Statement* stmt = con->createStatement();
+        sql::ResultSet* res = stmt->executeQuery("SELECT * FROM trains");
+        
+        while (res->next()) {
+            trains.push_back(trainFromRow(res));
+        }
+        
+        delete stmt;
+        delete res;
+        
+        loadStops(con, trains);
+        return trains;
+    }
+    
+    bool findTrain(int trainId, Train& train) override {
+        static OperationMetrics& metrics = Metrics::query("findTrain");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getReadConnection();
+        PreparedStatementHandle pstmt = con.prepare("SELECT * FROM trains WHERE train_id = ?");
+        
+        pstmt->setInt(1, trainId);
+        sql::ResultSet* res = pstmt->executeQuery();
+        
+        bool found = res->next();
+        if (found) {
+            train = trainFromRow(res);
+        }
+        
+        delete res;
+        
+        if (found) {
+            vector<Train> trains(1, train);
+            loadStops(con, trains);
+            train = trains.front();
+        }
+        
+        return found;
+    }
+    
+    vector<Train> searchTrains(const string& source, const string& destination) override {
+        static OperationMetrics& metrics = Metrics::query("searchTrains");
+        OperationTimer timer(metrics);
+        
+        vector<Train> trains;
+        
+        PooledConnection con = dbConnector->getReadConnection();
+        PreparedStatementHandle pstmt = con.prepare(
+            "SELECT * FROM trains WHERE source LIKE ? AND destination LIKE ?");
+        
+        pstmt->setString(1, "%" + source + "%");
+        pstmt->setString(2, "%" + destination + "%");
+        
+        sql::ResultSet* res = pstmt->executeQuery();
+        
+        while (res->next()) {
+            trains.push_back(trainFromRow(res));
+        }
+        
+        delete res;
+        
+        loadStops(con, trains);
+        return trains;
+    }
+    
+    // One round trip: the train's seats and stop count, joined with its confirmed bookings
+    // grouped by the stops they cover
+    bool countAvailableSeats(int trainId, const string& journeyDate, vector<int>& availableBySegment) override {
+        static OperationMetrics& metrics = Metrics::query("countAvailableSeats");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getConnection();
+        PreparedStatementHandle pstmt = con.prepare(
+            "SELECT t.total_seats, (SELECT COUNT(*) FROM train_stops s WHERE s.train_id = t.train_id) AS stop_count, "
+            "b.from_stop, b.to_stop, b.seats "
+            "FROM trains t LEFT JOIN (SELECT from_stop, to_stop, SUM(num_passengers) AS seats FROM bookings "
+            "WHERE train_id = ? AND journey_date = ? AND booking_status = 'Confirmed' GROUP BY from_stop, to_stop) b ON TRUE "
+            "WHERE t.train_id = ?");
+        
+        pstmt->setInt(1, trainId);
+        pstmt->setString(2, journeyDate);
+        pstmt->setInt(3, trainId);
+        
+        sql::ResultSet* res = pstmt->executeQuery();
+        
+        bool found = false;
+        while (res->next()) {
+            if (!found) {
+                int stopCount = max(res->getInt("stop_count"), 2);
+                availableBySegment.assign(stopCount - 1, res->getInt("total_seats"));
+                found = true;
+            }
+            
+            if (!res->isNull("seats")) {
+                takeSeats(availableBySegment, res->getInt("from_stop"), res->getInt("to_stop"), res->getInt("seats"));
+            }
+        }
+        
+        delete res;
+        
+        return found;
+    }
+    
+    // Same join for a set of trains and a date range, grouped by train and date as well.
+    // IDs and dates are inlined rather than bound, as both are numbers or normalized
+    // dates and the list length varies from call to call.
+    void countAvailableSeatsForDates(const vector<int>& trainIds, const vector<string>& journeyDates,
+                                     vector<vector<int>>& availableBySegment) override {
+        static OperationMetrics& metrics = Metrics::query("countAvailableSeatsForDates");
+        OperationTimer timer(metrics);
+        
+        availableBySegment.assign(trainIds.size() * journeyDates.size(), vector<int>());
+        if (trainIds.empty() || journeyDates.empty()) {
+            return;
+        }
+        
+        unordered_map<int, size_t> rowOf;
+        string idList;
+        for (size_t t = 0; t < trainIds.size(); t++) {
+            rowOf[trainIds[t]] = t;
+            idList += (t ? "," : "") + to_string(trainIds[t]);
+        }
+        
+        unordered_map<string, size_t> columnOf;
+        for (size_t d = 0; d < journeyDates.size(); d++) {
+            columnOf[Utility::normalizeDate(journeyDates[d])] = d;
+        }
+        string firstDate = columnOf.begin()->first;
+        string lastDate = firstDate;
+        for (const auto& column : columnOf) {
+            firstDate = min(firstDate, column.first);
+            lastDate = max(lastDate, column.first);
+        }
+        
+        PooledConnection con = dbConnector->getConnection();
+        sql::Statement* stmt = con->createStatement();
+        sql::ResultSet* res = stmt->executeQuery(
+            "SELECT t.train_id, t.total_seats, (SELECT COUNT(*) FROM train_stops s WHERE s.train_id = t.train_id) AS stop_count, "
+            "b.journey_date, b.from_stop, b.to_stop, b.seats "
+            "FROM trains t LEFT JOIN (SELECT train_id, journey_date, from_stop, to_stop, SUM(num_passengers) AS seats "
+            "FROM bookings WHERE train_id IN (" + idList + ") AND journey_date BETWEEN '" + firstDate + "' AND '" + lastDate + "' "
+            "AND booking_status = 'Confirmed' GROUP BY train_id, journey_date, from_stop, to_stop) b ON b.train_id = t.train_id "
+            "WHERE t.train_id IN (" + idList + ")");
+        
+        while (res->next()) {
+            size_t row = rowOf[res->getInt("train_id")];
+            vector<int>* cells = &availableBySegment[row * journeyDates.size()];
+            
+            // The train's first row lays out all of its dates
+            if (cells[0].empty()) {
+                int stopCount = max(res->getInt("stop_count"), 2);
+                for (size_t d = 0; d < journeyDates.size(); d++) {
+                    cells[d].assign(stopCount - 1, res->getInt("total_seats"));
+                }
+            }
+            
+            if (res->isNull("seats")) continue;
+            
+            auto column = columnOf.find(Utility::normalizeDate(res->getString("journey_date")));
+            if (column != columnOf.end()) {
+                takeSeats(cells[column->second], res->getInt("from_stop"), res->getInt("to_stop"), res->getInt("seats"));
+            }
+        }
+        
+        delete stmt;
+        delete res;
+    }
+    
+    bool getSeatAssignments(int trainId, const string& journeyDate, int& totalSeats,
+                            int& stopCount, vector<SeatAssignment>& seats) override {
+        static OperationMetrics& metrics = Metrics::query("getSeatAssignments");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getConnection();
+        PreparedStatementHandle pstmt = con.prepare(
+            "SELECT t.total_seats, (SELECT COUNT(*) FROM train_stops s WHERE s.train_id = t.train_id) AS stop_count "
+            "FROM trains t WHERE t.train_id = ?");
+        
+        pstmt->setInt(1, trainId);
+        sql::ResultSet* res = pstmt->executeQuery();
+        
+        if (!res->next()) {
+            delete res;
+            return false;
+        }
+        
+        totalSeats = res->getInt("total_seats");
+        stopCount = max(res->getInt("stop_count"), 2);
+        delete res;
+        
+        pstmt = con.prepare(
+            "SELECT p.seat_number, b.from_stop, b.to_stop FROM passengers p JOIN bookings b ON p.booking_id = b.booking_id "
+            "WHERE b.train_id = ? AND b.journey_date = ? AND b.booking_status = 'Confirmed'");
+        
+        pstmt->setInt(1, trainId);
+        pstmt->setString(2, journeyDate);
+        res = pstmt->executeQuery();
+        
+        while (res->next()) {
+            SeatAssignment seat = { res->getString("seat_number"), res->getInt("from_stop"), res->getInt("to_stop") };
+            seats.push_back(seat);
+        }
+        
+        delete res;
+        
+        return true;
+    }
+    
+    vector<RouteBookingCount> getRouteBookingCounts() override {
+        static OperationMetrics& metrics = Metrics::query("getRouteBookingCounts");
+        OperationTimer timer(metrics);
+        
+        vector<RouteBookingCount> routes;
+        
+        PooledConnection con = dbConnector->getReadConnection();
+        sql::Statement* stmt = con->createStatement();
+        sql::ResultSet* res = stmt->executeQuery(
+            "SELECT t.source, t.destination, COUNT(b.booking_id) AS bookings "
+            "FROM trains t LEFT JOIN bookings b ON b.train_id = t.train_id AND b.booking_status = 'Confirmed' "
+            "GROUP BY t.train_id, t.source, t.destination");
+        
+        while (res->next()) {
+            RouteBookingCount route;
+            route.source = res->getString("source");
+            route.destination = res->getString("destination");
+            route.bookings = res->getUInt64("bookings");
+            routes.push_back(route);
+        }
+        
+        delete stmt;
+        delete res;
+        
+        return routes;
+    }
+};
+
+class MySqlPassengerRepository : public PassengerRepository {
+private:
+    DatabaseConnector* dbConnector;
+    
+    // Rows per multi-row INSERT. Only the row counts 1..8 are ever prepared, so the
+    // insert takes at most 8 statement cache entries per connection.
+    static const size_t passengerRowsPerInsert = 8;
+
+public:
+    MySqlPassengerRepository(DatabaseConnector* connector) : dbConnector(connector) {}
+    
+    static string placeholderList(size_t count, const string& group) {
+        string list;
+        for (size_t i = 0; i < count; i++) {
+            if (i > 0) list += ", ";
+            list += group;
+        }
+        return list;
+    }
+    
+    // Insert (booking ID, passenger) rows with multi-row INSERTs on the caller's connection,
+    // so they join its transaction. Returns the generated passenger IDs in input order.
+    vector<int> insertPassengers(PooledConnection& con, const vector<pair<int, Passenger>>& rows) {
+        static OperationMetrics& metrics = Metrics::query("insertPassengers");
+        OperationTimer timer(metrics);
+        
+        vector<int> passengerIds;
+        
+        for (size_t offset = 0; offset < rows.size(); offset += passengerRowsPerInsert) {
+            size_t count = min(rows.size() - offset, (size_t)passengerRowsPerInsert);
+            PreparedStatementHandle pstmt = con.prepare(
+                "INSERT INTO passengers(booking_id, passenger_name, age, gender, seat_number) VALUES " +
+                placeholderList(count, "(?, ?, ?, ?, ?)"));
+            
+            for (size_t i = 0; i < count; i++) {
+                const pair<int, Passenger>& row = rows[offset + i];
+                unsigned int column = i * 5;
+                pstmt->setInt(column + 1, row.first);
+                pstmt->setString(column + 2, row.second.getPassengerName());
+                pstmt->setInt(column + 3, row.second.getAge());
+                pstmt->setString(column + 4, row.second.getGender());
+                pstmt->setString(column + 5, row.second.getSeatNumber());
+            }
+            
+            pstmt->executeUpdate();
+            
+            // LAST_INSERT_ID() is the first row's ID. InnoDB gives the rows of one multi-row
+            // INSERT with a known row count consecutive IDs, so the rest follow from it.
+            int firstId = 0;
+            sql::Statement* stmt = con->createStatement();
+            sql::ResultSet* res = stmt->executeQuery("SELECT LAST_INSERT_ID() as id");
+            if (res->next()) {
+                firstId = res->getInt("id");
+            }
+            delete stmt;
+            delete res;
+            
+            for (size_t i = 0; i < count; i++) {
+                passengerIds.push_back(firstId ? firstId + (int)i : 0);
+            }
+        }
+        
+        return passengerIds;
+    }
+    
+    vector<int> insertPassengers(const vector<pair<int, Passenger>>& rows) override {
+        PooledConnection con = dbConnector->getConnection();
+        con->setAutoCommit(false);
+        
+        vector<int> passengerIds = insertPassengers(con, rows);
+        
+        con->commit();
+        con->setAutoCommit(true);
+        
+        return passengerIds;
+    }
+};
+
+class MySqlBookingRepository : public BookingRepository {
+private:
+    DatabaseConnector* dbConnector;
+    MySqlPassengerRepository* passengerRepository;
+    
+    // Bookings matching the filter together with their passengers, in one joined query.
+    // Rows arrive grouped by booking, so consecutive rows with the same booking_id are merged.
+    // The filter takes an integer parameter, then a journey date if one is given.
+    vector<Booking> loadBookingsWithPassengers(PooledConnection con, const string& filter, int value,
+                                               const string& journeyDate = "") {
+        static OperationMetrics& metrics = Metrics::query("loadBookingsWithPassengers");
+        OperationTimer timer(metrics);
+        
+        vector<Booking> bookings;
+        
+        PreparedStatementHandle pstmt = con.prepare(
+            "SELECT b.*, p.passenger_id, p.passenger_name, p.age, p.gender, p.seat_number "
+            "FROM bookings b LEFT JOIN passengers p ON p.booking_id = b.booking_id "
+            "WHERE " + filter + " ORDER BY b.booking_date DESC, b.booking_id, p.passenger_id");
+        
+        pstmt->setInt(1, value);
+        if (!journeyDate.empty()) {
+            pstmt->setString(2, journeyDate);
+        }
+        sql::ResultSet* res = pstmt->executeQuery();
+        
+        while (res->next()) {
+            int bookingId = res->getInt("booking_id");
+            
+            if (bookings.empty() || bookings.back().getBookingId() != bookingId) {
+                bookings.push_back(Booking(
+                    bookingId,
+                    res->getInt("user_id"),
+                    res->getInt("train_id"),
+                    res->getString("booking_date"),
+                    res->getString("journey_date"),
+                    res->getInt("num_passengers"),
+                    res->getDouble("total_fare"),
+                    res->getString("booking_status"),
+                    res->getString("payment_status")
+                ));
+                bookings.back().setStops(res->getInt("from_stop"), res->getInt("to_stop"));
+            }
+            
+            // LEFT JOIN yields one all-NULL passenger row for a booking without passengers
+            if (!res->isNull("passenger_id")) {
+                Passenger passenger(
+                    res->getInt("passenger_id"),
+                    res->getString("passenger_name"),
+                    res->getInt("age"),
+                    res->getString("gender"),
+                    res->getString("seat_number")
+                );
+                
+                bookings.back().addPassenger(passenger);
+            }
+        }
+        
+        delete res;
+        
+        return bookings;
+    }
+    
+    // Keep the booking's owner reading from the primary until replicas have this write
+    void noteWriteFor(PooledConnection& con, int bookingId) {
+        if (!dbConnector->hasReplicas()) {
+            return;
+        }
+        
+        PreparedStatementHandle pstmt = con.prepare("SELECT user_id FROM bookings WHERE booking_id = ?");
+        pstmt->setInt(1, bookingId);
+        sql::ResultSet* res = pstmt->executeQuery();
+        
+        if (res->next()) {
+            dbConnector->noteWrite(res->getInt("user_id"));
+        }
+        
+        delete res;
+    }
+
+public:
+    MySqlBookingRepository(DatabaseConnector* connector, MySqlPassengerRepository* passengers)
+        : dbConnector(connector), passengerRepository(passengers) {}
+    
+    void insertBooking(Booking& booking) override {
+        static OperationMetrics& metrics = Metrics::query("insertBooking");
+        OperationTimer timer(metrics);
+        
+        // Booking and passenger rows commit together; the pool rolls back if we bail out early
+        PooledConnection con = dbConnector->getConnection();
+        con->setAutoCommit(false);
+        
+        PreparedStatementHandle pstmt = con.prepare(
+            "INSERT INTO bookings(user_id, train_id, booking_date, journey_date, num_passengers, total_fare, booking_status, payment_status, from_stop, to_stop, booking_key) "
+            "VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, NULLIF(?, ''))");
+        
+        pstmt->setInt(1, booking.getUserId());
+        pstmt->setInt(2, booking.getTrainId());
+        pstmt->setString(3, booking.getBookingDate());
+        pstmt->setString(4, booking.getJourneyDate());
+        pstmt->setInt(5, booking.getNumPassengers());
+        pstmt->setDouble(6, booking.getTotalFare());
+        pstmt->setString(7, booking.getBookingStatus());
+        pstmt->setString(8, booking.getPaymentStatus());
+        pstmt->setInt(9, booking.getFromStop());
+        pstmt->setInt(10, booking.getToStop());
+        pstmt->setString(11, booking.getBookingKey());
+        
+        pstmt->executeUpdate();
+        
+        // Get the booking ID of the newly created booking
+        sql::Statement* stmt = con->createStatement();
+        sql::ResultSet* res = stmt->executeQuery("SELECT LAST_INSERT_ID() as id");
+        
+        if (res->next()) {
+            booking.setBookingId(res->getInt("id"));
+        }
+        
+        delete stmt;
+        delete res;
+        
+        // Add passengers
+        vector<pair<int, Passenger>> rows;
+        for (const auto& passenger : booking.getPassengers()) {
+            rows.push_back(make_pair(booking.getBookingId(), passenger));
+        }
+        booking.assignPassengerIds(passengerRepository->insertPassengers(con, rows));
+        
+        con->commit();
+        con->setAutoCommit(true);
+        dbConnector->noteWrite(booking.getUserId());
+    }
+    
+    bool markCancelled(int bookingId, const string& currentStatus) override {
+        static OperationMetrics& metrics = Metrics::query("markCancelled");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getConnection();
+        PreparedStatementHandle pstmt = con.prepare(
+            "UPDATE bookings SET booking_status = 'Cancelled' WHERE booking_id = ? AND booking_status = ? "
+            "AND booking_status <> 'Cancelled'");
+        
+        pstmt->setInt(1, bookingId);
+        pstmt->setString(2, currentStatus);
+        if (pstmt->executeUpdate() == 0) {
+            return false;
+        }
+        
+        noteWriteFor(con, bookingId);
+        return true;
+    }
+    
+    void updatePaymentStatus(int bookingId, const string& status) override {
+        static OperationMetrics& metrics = Metrics::query("updatePaymentStatus");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getConnection();
+        PreparedStatementHandle pstmt = con.prepare(
+            "UPDATE bookings SET payment_status = ? WHERE booking_id = ?");
+        
+        pstmt->setString(1, status);
+        pstmt->setInt(2, bookingId);
+        pstmt->executeUpdate();
+        noteWriteFor(con, bookingId);
+    }
+    
+    void updatePaymentStatuses(const vector<int>& bookingIds, const string& status) override {
+        static OperationMetrics& metrics = Metrics::query("updatePaymentStatuses");
+        OperationTimer timer(metrics);
+        
+        if (bookingIds.empty()) {
+            return;
+        }
+        
+        // Up to 64 IDs per statement, padded to 1, 8 or 64 by repeating the last one, so only
+        // three statement texts of each kind reach the statement cache
+        PooledConnection con = dbConnector->getConnection();
+        con->setAutoCommit(false);
+        
+        for (size_t offset = 0; offset < bookingIds.size(); offset += 64) {
+            size_t count = min(bookingIds.size() - offset, (size_t)64);
+            size_t padded = count == 1 ? 1 : count <= 8 ? 8 : 64;
+            string idList = MySqlPassengerRepository::placeholderList(padded, "?");
+            
+            PreparedStatementHandle pstmt = con.prepare(
+                "UPDATE bookings SET payment_status = ? WHERE booking_id IN (" + idList + ")");
+            pstmt->setString(1, status);
+            for (size_t i = 0; i < padded; i++) {
+                pstmt->setInt(i + 2, bookingIds[offset + min(i, count - 1)]);
+            }
+            pstmt->executeUpdate();
+            
+            if (dbConnector->hasReplicas()) {
+                PreparedStatementHandle owners = con.prepare(
+                    "SELECT DISTINCT user_id FROM bookings WHERE booking_id IN (" + idList + ")");
+                for (size_t i = 0; i < padded; i++) {
+                    owners->setInt(i + 1, bookingIds[offset + min(i, count - 1)]);
+                }
+                
+                sql::ResultSet* res = owners->executeQuery();
+                while (res->next()) {
+                    dbConnector->noteWrite(res->getInt("user_id"));
+                }
+                delete res;
+            }
+        }
+        
+        con->commit();
+        con->setAutoCommit(true);
+    }
+    
+    // Booking history is browse traffic, so it may come from a replica that has the user's writes
+    vector<Booking> findUserBookings(int userId) override {
+        return loadBookingsWithPassengers(dbConnector->getReadConnection(userId), "b.user_id = ?", userId);
+    }
+    
+    bool findBooking(int bookingId, Booking& booking) override {
+        vector<Booking> bookings = loadBookingsWithPassengers(dbConnector->getConnection(), "b.booking_id = ?", bookingId);
+        
+        if (bookings.empty()) {
+            return false;
+        }
+        
+        booking = bookings.front();
+        return true;
+    }
+    
+    bool findBookingByKey(const string& bookingKey, int& bookingId) override {
+        static OperationMetrics& metrics = Metrics::query("findBookingByKey");
+        OperationTimer timer(metrics);
+        
+        PooledConnection con = dbConnector->getConnection();
+        PreparedStatementHandle pstmt = con.prepare("SELECT booking_id FROM bookings WHERE booking_key = ?");
+        pstmt->setString(1, bookingKey);
+        sql::ResultSet* res = pstmt->executeQuery();
+        
+        bool found = res->next();
+        if (found) {
+            bookingId = res->getInt("booking_id");
+        }
+        
+        delete res;
+        return found;
+    }
+    
+    vector<Booking> findWaitingBookings(int trainId, const string& journeyDate) override {
+        return loadBookingsWithPassengers(dbConnector->getConnection(),
+            "b.train_id = ? AND b.journey_date = ? AND b.booking_status = 'Waiting'", trainId, journeyDate);
+    }
+    
+    bool confirmWaiting(int bookingId, const vector<string>& seatNumbers) override {
+        static OperationMetrics& metrics = Metrics::query("confirmWaiting");
+        OperationTimer timer(metrics);
+        
+        // Status and seats commit together; the pool rolls back if we bail out early
+        PooledConnection con = dbConnector->getConnection();
+        con->setAutoCommit(false);
+        
+        PreparedStatementHandle confirm = con.prepare(
+            "UPDATE bookings SET booking_status = 'Confirmed' WHERE booking_id = ? AND booking_status = 'Waiting'");
+        
+        confirm->setInt(1, bookingId);
+        if (confirm->executeUpdate() == 0) {
+            return false;
+        }
+        
+        PreparedStatementHandle select = con.prepare(
+            "SELECT passenger_id FROM passengers WHERE booking_id = ? ORDER BY passenger_id");
+        
+        select->setInt(1, bookingId);
+        sql::ResultSet* res = select->executeQuery();
+        
+        vector<int> passengerIds;
+        while (res->next()) {
+            passengerIds.push_back(res->getInt("passenger_id"));
+        }
+        
+        delete res;
+        
+        PreparedStatementHandle assign = con.prepare(
+            "UPDATE passengers SET seat_number = ? WHERE passenger_id = ?");
+        
+        for (size_t i = 0; i < passengerIds.size() && i < seatNumbers.size(); i++) {
+            assign->setString(1, seatNumbers[i]);
+            assign->setInt(2, passengerIds[i]);
+            assign->executeUpdate();
+        }
+        
+        con->commit();
+        con->setAutoCommit(true);
+        noteWriteFor(con, bookingId);
+        return true;
+    }
+};
+
+class MySqlBackend : public StorageBackend {
+private:
+    const string journalPath = "booking_journal.log";
+    const bool applyBookingsAsync = false; // Acknowledge bookings once journaled, store them in the background
+    
+    DatabaseConnector connector;
+    MySqlUserRepository userRepository;
+    MySqlTrainRepository trainRepository;
+    MySqlPassengerRepository passengerRepository;
+    MySqlBookingRepository bookingRepository;
+    BookingJournal journal;
+    JournaledTrainRepository journaledTrainRepository;
+    JournaledBookingRepository journaledBookingRepository;
+    ThreadPool executor; // Sized to the connection pool; more threads would only wait for connections
+
+public:
+    MySqlBackend()
+        : userRepository(&connector), trainRepository(&connector),
+          passengerRepository(&connector), bookingRepository(&connector, &passengerRepository),
+          journal(journalPath), journaledTrainRepository(&trainRepository, &journal),
+          journaledBookingRepository(&bookingRepository, &trainRepository, &journal, applyBookingsAsync),
+          executor(connector.getPoolMaxSize()) {}
+    
+    UserRepository* users() override { return &userRepository; }
+    TrainRepository* trains() override { return &journaledTrainRepository; }
+    BookingRepository* bookings() override { return &journaledBookingRepository; }
+    PassengerRepository* passengers() override { return &passengerRepository; }
+    ThreadPool* queryExecutor() override { return &executor; }
+    
+    DatabaseConnector* getConnector() { return &connector; }
+};
+
+// ----- In memory -----
+// Holds every table in process memory with the same rules the MySQL schema enforces
+// (unique usernames/emails, foreign keys, ENUM values), for load tests and demos
+// without a database server. Each table has its own mutex.
+class InMemoryBackend : public StorageBackend, public UserRepository, public TrainRepository,
+                        public BookingRepository, public PassengerRepository {
+private:
+    mutex usersMutex;
+    map<int, User> usersById;
+    unordered_map<string, int> userIdsByUsername;
+    unordered_map<string, int> userIdsByEmail;
+    int nextUserId;
+    
+    mutex trainsMutex;
+    map<int, Train> trainsById;
+    int nextTrainId;
+    
+    mutex bookingsMutex;
+    map<int, Booking> bookingsById;
+    unordered_map<int, vector<int>> bookingIdsByUser;
+    unordered_map<string, vector<int>> bookingIdsByTrainDate;
+    unordered_map<string, int> bookingIdsByKey;
+    int nextBookingId;
+    int nextPassengerId;
+    
+    // Case-insensitive ENUM match, returning the canonical spelling like MySQL does
+    static string enumValue(const string& value, const vector<string>& allowed, const string& column) {
+        for (const auto& option : allowed) {
+            if (StationIndex::fold(option) == StationIndex::fold(value)) return option;
+        }
+        throw sql::SQLException("Data truncated for column '" + column + "'");
+    }
+    
+    bool userExists(int userId) {
+        lock_guard<mutex> lock(usersMutex);
+        return usersById.count(userId) > 0;
+    }
+    
+    bool trainExists(int trainId) {
+        lock_guard<mutex> lock(trainsMutex);
+        return trainsById.count(trainId) > 0;
+    }
+    
+    // Validate and assign an ID to a passenger row; bookingsMutex must be held
+    Passenger storePassenger(Booking& stored, Passenger passenger) {
+        passenger.setGender(enumValue(passenger.getGender(), {"Male", "Female", "Other"}, "gender"));
+        passenger.setPassengerId(nextPassengerId++);
+        stored.addPassenger(passenger);
+        return passenger;
+    }
+
+public:
+    InMemoryBackend() : nextUserId(1), nextTrainId(1), nextBookingId(1), nextPassengerId(1) {}
+    
+    UserRepository* users() override { return this; }
+    TrainRepository* trains() override { return this; }
+    BookingRepository* bookings() override { return this; }
+    PassengerRepository* passengers() override { return this; }
+    
+    // Trains are read-only to the application, so they are added here directly
+    int addTrain(Train train) {
+        lock_guard<mutex> lock(trainsMutex);
+        if (train.getTrainId() == 0) {
+            train.setTrainId(nextTrainId);
+        }
+        nextTrainId = max(nextTrainId, train.getTrainId() + 1);
+        trainsById[train.getTrainId()] = train;
+        return train.getTrainId();
+    }
+    
+    // The sample rows from the schema script
+    void addSampleTrains() {
+        Train rajdhani(0, "Rajdhani Express", "RAJ2025", "Delhi", "Mumbai", "16:00:00", "08:00:00", 500);
+        rajdhani.setStops({
+            { "Delhi", "", "16:00:00" },
+            { "Kota", "21:30:00", "21:40:00" },
+            { "Vadodara", "03:20:00", "03:30:00" },
+            { "Surat", "05:00:00", "05:05:00" },
+            { "Mumbai", "08:00:00", "" }
+        });
+        addTrain(rajdhani);
+        addTrain(Train(0, "Shatabdi Express", "SHT1050", "Chennai", "Bangalore", "06:00:00", "10:30:00", 400));
+        addTrain(Train(0, "Duronto Express", "DUR2210", "Kolkata", "Delhi", "23:00:00", "14:00:00", 450));
+    }
+    
+    // ----- Users -----
+    void insertUser(User& user) override {
+        lock_guard<mutex> lock(usersMutex);
+        
+        if (userIdsByUsername.count(user.getUsername())) {
+            throw sql::SQLException("Duplicate entry '" + user.getUsername() + "' for key 'username'");
+        }
+        if (userIdsByEmail.count(user.getEmail())) {
+            throw sql::SQLException("Duplicate entry '" + user.getEmail() + "' for key 'email'");
+        }
+        
+        user.setUserId(nextUserId++);
+        user.setRegistrationDate(Utility::getCurrentDate());
+        usersById[user.getUserId()] = user;
+        userIdsByUsername[user.getUsername()] = user.getUserId();
+        userIdsByEmail[user.getEmail()] = user.getUserId();
+    }
+    
+    User* findUserByCredentials(const string& username, const string& password) override {
+        lock_guard<mutex> lock(usersMutex);
+        
+        auto it = userIdsByUsername.find(username);
+        if (it == userIdsByUsername.end()) return nullptr;
+        
+        const User& user = usersById[it->second];
+        return user.getPassword() == password ? new User(user) : nullptr;
+    }
+    
+    void updateUser(const User& user) override {
+        lock_guard<mutex> lock(usersMutex);
+        
+        auto it = usersById.find(user.getUserId());
+        if (it == usersById.end()) return;
+        
+        auto owner = userIdsByEmail.find(user.getEmail());
+        if (owner != userIdsByEmail.end() && owner->second != user.getUserId()) {
+            throw sql::SQLException("Duplicate entry '" + user.getEmail() + "' for key 'email'");
+        }
+        
+        userIdsByEmail.erase(it->second.getEmail());
+        userIdsByEmail[user.getEmail()] = user.getUserId();
+        it->second.setName(user.getName());
+        it->second.setEmail(user.getEmail());
+        it->second.setPhone(user.getPhone());
+    }
+    
+    void updatePassword(int userId, const string& newPassword) override {
+        lock_guard<mutex> lock(usersMutex);
+        
+        auto it = usersById.find(userId);
+        if (it != usersById.end()) {
+            it->second.setPassword(newPassword);
+        }
+    }
+    
+    // ----- Trains -----
+    vector<Train> getAllTrains() override {
+        lock_guard<mutex> lock(trainsMutex);
+        
+        vector<Train> trains;
+        for (const auto& entry : trainsById) trains.push_back(entry.second);
+        return trains;
+    }
+    
+    bool findTrain(int trainId, Train& train) override {
+        lock_guard<mutex> lock(trainsMutex);
+        
+        auto it = trainsById.find(trainId);
+        if (it == trainsById.end()) return false;
+        
+        train = it->second;
+        return true;
+    }
+    
+    vector<Train> searchTrains(const string& source, const string& destination) override {
+        string foldedSource = StationIndex::fold(source);
+        string foldedDestination = StationIndex::fold(destination);
+        
+        lock_guard<mutex> lock(trainsMutex);
+        
+        vector<Train> trains;
+        for (const auto& entry : trainsById) {
+            const Train& train = entry.second;
+            if (StationIndex::fold(train.getSource()).find(foldedSource) != string::npos &&
+                StationIndex::fold(train.getDestination()).find(foldedDestination) != string::npos) {
+                trains.push_back(train);
+            }
+        }
+        return trains;
+    }
+    
+    bool countAvailableSeats(int trainId, const string& journeyDate, vector<int>& availableBySegment) override {
+        {
+            lock_guard<mutex> lock(trainsMutex);
+            auto it = trainsById.find(trainId);
+            if (it == trainsById.end()) return false;
+            availableBySegment.assign(it->second.getStopCount() - 1, it->second.getTotalSeats());
+        }
+        
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        auto it = bookingIdsByTrainDate.find(SeatInventory::makeKey(trainId, journeyDate));
+        if (it != bookingIdsByTrainDate.end()) {
+            for (int bookingId : it->second) {
+                const Booking& booking = bookingsById[bookingId];
+                if (booking.getBookingStatus() == "Confirmed") {
+                    takeSeats(availableBySegment, booking.getFromStop(), booking.getToStop(), booking.getNumPassengers());
+                }
+            }
+        }
+        return true;
+    }
+    
+    void countAvailableSeatsForDates(const vector<int>& trainIds, const vector<string>& journeyDates,
+                                     vector<vector<int>>& availableBySegment) override {
+        availableBySegment.assign(trainIds.size() * journeyDates.size(), vector<int>());
+        {
+            lock_guard<mutex> lock(trainsMutex);
+            for (size_t t = 0; t < trainIds.size(); t++) {
+                auto it = trainsById.find(trainIds[t]);
+                if (it == trainsById.end()) continue;
+                for (size_t d = 0; d < journeyDates.size(); d++) {
+                    availableBySegment[t * journeyDates.size() + d].assign(
+                        it->second.getStopCount() - 1, it->second.getTotalSeats());
+                }
+            }
+        }
+        
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        for (size_t t = 0; t < trainIds.size(); t++) {
+            for (size_t d = 0; d < journeyDates.size(); d++) {
+                vector<int>& cell = availableBySegment[t * journeyDates.size() + d];
+                auto it = bookingIdsByTrainDate.find(SeatInventory::makeKey(trainIds[t], journeyDates[d]));
+                if (cell.empty() || it == bookingIdsByTrainDate.end()) continue;
+                
+                for (int bookingId : it->second) {
+                    const Booking& booking = bookingsById[bookingId];
+                    if (booking.getBookingStatus() == "Confirmed") {
+                        takeSeats(cell, booking.getFromStop(), booking.getToStop(), booking.getNumPassengers());
+                    }
+                }
+            }
+        }
+    }
+    
+    bool getSeatAssignments(int trainId, const string& journeyDate, int& totalSeats,
+                            int& stopCount, vector<SeatAssignment>& seats) override {
+        {
+            lock_guard<mutex> lock(trainsMutex);
+            auto it = trainsById.find(trainId);
+            if (it == trainsById.end()) return false;
+            totalSeats = it->second.getTotalSeats();
+            stopCount = it->second.getStopCount();
+        }
+        
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        auto it = bookingIdsByTrainDate.find(SeatInventory::makeKey(trainId, journeyDate));
+        if (it != bookingIdsByTrainDate.end()) {
+            for (int bookingId : it->second) {
+                const Booking& booking = bookingsById[bookingId];
+                if (booking.getBookingStatus() != "Confirmed") continue;
+                for (const auto& passenger : booking.getPassengers()) {
+                    SeatAssignment seat = { passenger.getSeatNumber(), booking.getFromStop(), booking.getToStop() };
+                    seats.push_back(seat);
+                }
+            }
+        }
+        return true;
+    }
+    
+    vector<RouteBookingCount> getRouteBookingCounts() override {
+        unordered_map<int, unsigned long long> counts;
+        {
+            lock_guard<mutex> lock(bookingsMutex);
+            for (const auto& entry : bookingsById) {
+                if (entry.second.getBookingStatus() == "Confirmed") counts[entry.second.getTrainId()]++;
+            }
+        }
+        
+        lock_guard<mutex> lock(trainsMutex);
+        
+        vector<RouteBookingCount> routes;
+        for (const auto& entry : trainsById) {
+            RouteBookingCount route;
+            route.source = entry.second.getSource();
+            route.destination = entry.second.getDestination();
+            route.bookings = counts[entry.first];
+            routes.push_back(route);
+        }
+        return routes;
+    }
+    
+    // ----- Bookings and passengers -----
+    void insertBooking(Booking& booking) override {
+        if (!userExists(booking.getUserId()) || !trainExists(booking.getTrainId())) {
+            throw sql::SQLException("Cannot add or update a child row: a foreign key constraint fails");
+        }
+        
+        Booking stored(0, booking.getUserId(), booking.getTrainId(),
+                       Utility::normalizeDate(booking.getBookingDate()),
+                       Utility::normalizeDate(booking.getJourneyDate()),
+                       booking.getNumPassengers(), booking.getTotalFare(),
+                       enumValue(booking.getBookingStatus(), {"Confirmed", "Waiting", "Cancelled"}, "booking_status"),
+                       enumValue(booking.getPaymentStatus(), {"Paid", "Pending"}, "payment_status"));
+        stored.setStops(booking.getFromStop(), booking.getToStop());
+        stored.setBookingKey(booking.getBookingKey());
+        
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        if (!stored.getBookingKey().empty() && bookingIdsByKey.count(stored.getBookingKey())) {
+            throw sql::SQLException("Duplicate entry '" + stored.getBookingKey() + "' for key 'booking_key'");
+        }
+        
+        // Validate every passenger before anything becomes visible
+        vector<Passenger> passengers = booking.getPassengers();
+        for (auto& passenger : passengers) {
+            passenger.setGender(enumValue(passenger.getGender(), {"Male", "Female", "Other"}, "gender"));
+        }
+        
+        stored.setBookingId(nextBookingId++);
+        vector<int> passengerIds;
+        for (const auto& passenger : passengers) {
+            passengerIds.push_back(storePassenger(stored, passenger).getPassengerId());
+        }
+        
+        bookingsById[stored.getBookingId()] = stored;
+        bookingIdsByUser[stored.getUserId()].push_back(stored.getBookingId());
+        bookingIdsByTrainDate[SeatInventory::makeKey(stored.getTrainId(), stored.getJourneyDate())].push_back(stored.getBookingId());
+        if (!stored.getBookingKey().empty()) {
+            bookingIdsByKey[stored.getBookingKey()] = stored.getBookingId();
+        }
+        
+        booking.setBookingId(stored.getBookingId());
+        booking.assignPassengerIds(passengerIds);
+    }
+    
+    vector<int> insertPassengers(const vector<pair<int, Passenger>>& rows) override {
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        for (const auto& row : rows) {
+            if (!bookingsById.count(row.first)) {
+                throw sql::SQLException("Cannot add or update a child row: a foreign key constraint fails");
+            }
+            enumValue(row.second.getGender(), {"Male", "Female", "Other"}, "gender");
+        }
+        
+        vector<int> passengerIds;
+        for (const auto& row : rows) {
+            passengerIds.push_back(storePassenger(bookingsById[row.first], row.second).getPassengerId());
+        }
+        return passengerIds;
+    }
+    
+    bool markCancelled(int bookingId, const string& currentStatus) override {
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        auto it = bookingsById.find(bookingId);
+        if (it == bookingsById.end() || it->second.getBookingStatus() == "Cancelled" ||
+            it->second.getBookingStatus() != currentStatus) return false;
+        
+        it->second.setBookingStatus("Cancelled");
+        return true;
+    }
+    
+    void updatePaymentStatus(int bookingId, const string& status) override {
+        string value = enumValue(status, {"Paid", "Pending"}, "payment_status");
+        
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        auto it = bookingsById.find(bookingId);
+        if (it != bookingsById.end()) {
+            it->second.setPaymentStatus(value);
+        }
+    }
+    
+    void updatePaymentStatuses(const vector<int>& bookingIds, const string& status) override {
+        string value = enumValue(status, {"Paid", "Pending"}, "payment_status");
+        
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        for (int bookingId : bookingIds) {
+            auto it = bookingsById.find(bookingId);
+            if (it != bookingsById.end()) {
+                it->second.setPaymentStatus(value);
+            }
+        }
+    }
+    
+    vector<Booking> findUserBookings(int userId) override {
+        vector<Booking> bookings;
+        {
+            lock_guard<mutex> lock(bookingsMutex);
+            
+            auto it = bookingIdsByUser.find(userId);
+            if (it != bookingIdsByUser.end()) {
+                for (int bookingId : it->second) bookings.push_back(bookingsById[bookingId]);
+            }
+        }
+        
+        // Same order as the MySQL query: booking date descending, then booking ID
+        stable_sort(bookings.begin(), bookings.end(), [](const Booking& a, const Booking& b) {
+            return a.getBookingDate() > b.getBookingDate();
+        });
+        return bookings;
+    }
+    
+    bool findBooking(int bookingId, Booking& booking) override {
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        auto it = bookingsById.find(bookingId);
+        if (it == bookingsById.end()) return false;
+        
+        booking = it->second;
+        return true;
+    }
+    
+    bool findBookingByKey(const string& bookingKey, int& bookingId) override {
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        auto it = bookingIdsByKey.find(bookingKey);
+        if (it == bookingIdsByKey.end()) return false;
+        
+        bookingId = it->second;
+        return true;
+    }
+    
+    vector<Booking> findWaitingBookings(int trainId, const string& journeyDate) override {
+        vector<Booking> bookings;
+        
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        // IDs are appended in creation order, so these come out in booking ID order
+        auto it = bookingIdsByTrainDate.find(SeatInventory::makeKey(trainId, journeyDate));
+        if (it != bookingIdsByTrainDate.end()) {
+            for (int bookingId : it->second) {
+                const Booking& booking = bookingsById[bookingId];
+                if (booking.getBookingStatus() == "Waiting") bookings.push_back(booking);
+            }
+        }
+        return bookings;
+    }
+    
+    bool confirmWaiting(int bookingId, const vector<string>& seatNumbers) override {
+        lock_guard<mutex> lock(bookingsMutex);
+        
+        auto it = bookingsById.find(bookingId);
+        if (it == bookingsById.end() || it->second.getBookingStatus() != "Waiting") return false;
+        
+        it->second.setBookingStatus("Confirmed");
+        it->second.assignSeats(seatNumbers);
+        return true;
+    }
+};
+
+// ============= PAYMENT SYSTEM =============
+class PaymentGateway {
+public:
+    enum Result { Approved, Declined, Error };
+    
+    virtual ~PaymentGateway() {}
+    
+    // Charge at most once per idempotency key: repeating a key that was charged returns
+    // Approved without charging again. Error means the outcome is unknown and the same
+    // key may be retried.
+    virtual Result charge(const string& idempotencyKey, int bookingId, double amount, const string& method) = 0;
+    
+    // What became of earlier charges under this key, without charging: Approved if one
+    // went through, Declined if none did, Error if the gateway cannot tell right now
+    virtual Result lookup(const string& idempotencyKey) = 0;
+};
+
+// Local stand-in for a card gateway. Each call takes latency on average (uniform from
+// half to one and a half times it); failureRate of calls return Error, and half of
+// those have charged the card before the reply was lost.
+class SimulatedPaymentGateway : public PaymentGateway {
+private:
+    chrono::milliseconds latency;
+    double failureRate;
+    
+    mutex mtx;
+    unordered_set<string> charged;
+    atomic<uint64_t> calls;
+    
+    static double roll() {
+        static thread_local mt19937 rng(random_device{}());
+        return uniform_real_distribution<double>(0.0, 1.0)(rng);
+    }
+    
+    void simulateLatency() {
+        calls++;
+        this_thread::sleep_for(chrono::microseconds((long long)(latency.count() * 1000 * (0.5 + roll()))));
+    }
+
+public:
+    SimulatedPaymentGateway(chrono::milliseconds latency = chrono::milliseconds(200), double failureRate = 0.05)
+        : latency(latency), failureRate(failureRate), calls(0) {}
+    
+    // The booking ID only matters to a real gateway's records
+    Result charge(const string& idempotencyKey, int /* bookingId */, double amount, const string& method) override {
+        simulateLatency();
+        
+        // Requests a real gateway would reject outright; a booking for children under 5 alone
+        // costs nothing and still goes through
+        if (amount < 0 || method.empty()) {
+            return Declined;
+        }
+        
+        bool failed = roll() < failureRate;
+        if (failed && roll() < 0.5) {
+            return Error;
+        }
+        
+        {
+            lock_guard<mutex> lock(mtx);
+            charged.insert(idempotencyKey);
+        }
+        return failed ? Error : Approved;
+    }
+    
+    Result lookup(const string& idempotencyKey) override {
+        simulateLatency();
+        if (roll() < failureRate) {
+            return Error;
+        }
+        
+        lock_guard<mutex> lock(mtx);
+        return charged.count(idempotencyKey) ? Approved : Declined;
+    }
+    
+    // Distinct keys charged; with idempotency working this never exceeds the payments made
+    size_t chargeCount() {
+        lock_guard<mutex> lock(mtx);
+        return charged.size();
+    }
+    
+    uint64_t callCount() const {
+        return calls.load();
+    }
+};
+
+// Payments run off the booking path. submit() queues a payment under its idempotency
+// key and returns at once; worker threads charge the gateway, retrying errors with the
+// same key, and a flusher thread marks charged bookings Paid in batches, one UPDATE per
+// batch. A charge that still errors after the last attempt may have gone through, so
+// the payment becomes Unknown and a reconciler thread looks its key up at the gateway
+// until it turns out Charged or Failed. A key that is queued, in progress, unknown or
+// paid is never charged twice: submitting it again returns the payment already
+// recorded. Only a failed payment can be retried, and always for the same booking, since
+// keys are scoped to their booking by keyFor().
+class PaymentSystem {
+public:
+    enum State { Queued, Processing, Charged, Paid, Failed, Unknown };
+    
+    struct Payment {
+        string key;
+        int bookingId;
+        double amount;
+        string method;
+        State state;
+        int attempts; // Gateway calls so far
+        chrono::steady_clock::time_point settledAt; // When it became Paid or Failed
+    };
+
+private:
+    BookingManager* bookingManager;
+    unique_ptr<PaymentGateway> gateway;
+    const size_t queueCapacity;
+    const int maxAttempts = 3;
+    const chrono::milliseconds retryDelay = chrono::milliseconds(100);
+    const size_t batchSize = 64;
+    const chrono::milliseconds flushInterval = chrono::milliseconds(50);
+    const chrono::milliseconds maxFlushBackoff = chrono::milliseconds(5000);
+    const chrono::milliseconds reconcileInterval = chrono::milliseconds(500);
+    const chrono::seconds retention = chrono::seconds(15 * 60); // Settled payments are forgotten after this
+    
+    mutex mtx;
+    condition_variable workAvailable;
+    condition_variable flushWake;
+    condition_variable reconcileWake;
+    condition_variable settled;       // A payment reached Paid or Failed
+    deque<string> queue;              // Keys waiting for a worker
+    unordered_map<string, Payment> payments;
+    vector<string> charged;           // Keys waiting for the status update
+    vector<string> unknown;           // Keys waiting for a gateway lookup
+    deque<pair<chrono::steady_clock::time_point, string>> expiry; // Settled keys, oldest first
+    bool stopping;
+    bool reconcilerStopping;
+    bool flusherStopping;
+    vector<thread> workers;
+    thread reconciler;
+    thread flusher;
+    
+    // mtx must be held
+    void settle(Payment& payment, State state) {
+        payment.state = state;
+        payment.settledAt = chrono::steady_clock::now();
+        expiry.push_back(make_pair(payment.settledAt, payment.key));
+        settled.notify_all();
+    }
+    
+    // Forget payments settled longer ago than the retention window; by then the booking's
+    // payment status and the gateway's own idempotency cover a repeated key. mtx must be held.
+    void expireSettled() {
+        chrono::steady_clock::time_point cutoff = chrono::steady_clock::now() - retention;
+        while (!expiry.empty() && expiry.front().first <= cutoff) {
+            // A failed payment may have been submitted again since
+            auto it = payments.find(expiry.front().second);
+            if (it != payments.end() && (it->second.state == Paid || it->second.state == Failed) &&
+                it->second.settledAt == expiry.front().first) {
+                payments.erase(it);
+            }
+            expiry.pop_front();
+        }
+    }
+    
+    void workLoop() {
+        static OperationMetrics& metrics = Metrics::operation("chargePayment");
+        
+        unique_lock<mutex> lock(mtx);
+        while (true) {
+            workAvailable.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return; // Stopping, and everything queued has been taken
+            }
+            
+            Payment& payment = payments[queue.front()];
+            queue.pop_front();
+            payment.state = Processing;
+            Payment request = payment;
+            lock.unlock();
+            
+            PaymentGateway::Result result = PaymentGateway::Error;
+            chrono::milliseconds delay = retryDelay;
+            int attempts = 0;
+            while (attempts < maxAttempts) {
+                OperationTimer timer(metrics);
+                attempts++;
+                result = gateway->charge(request.key, request.bookingId, request.amount, request.method);
+                if (result == PaymentGateway::Approved) break;
+                
+                timer.fail();
+                if (result == PaymentGateway::Declined || attempts == maxAttempts) break;
+                this_thread::sleep_for(delay);
+                delay *= 2;
+            }
+            
+            lock.lock();
+            payment.attempts += attempts;
+            if (result == PaymentGateway::Approved) {
+                payment.state = Charged;
+                charged.push_back(payment.key);
+                if (charged.size() >= batchSize) flushWake.notify_one();
+            } else if (result == PaymentGateway::Error) {
+                // The card may have been charged; never report this payment as failed unchecked
+                payment.state = Unknown;
+                unknown.push_back(payment.key);
+            } else {
+                settle(payment, Failed);
+            }
+        }
+    }
+    
+    // Look up unknown outcomes at the gateway: a charge that went through is recorded like
+    // any other, one that never did fails the payment, and a failed lookup is retried on
+    // the next pass. Makes a last pass when stopping. Also expires settled payments.
+    void reconcileLoop() {
+        static OperationMetrics& metrics = Metrics::operation("reconcilePayment");
+        
+        unique_lock<mutex> lock(mtx);
+        while (true) {
+            reconcileWake.wait_for(lock, reconcileInterval, [this] { return reconcilerStopping; });
+            bool last = reconcilerStopping;
+            expireSettled();
+            
+            vector<string> keys;
+            keys.swap(unknown);
+            lock.unlock();
+            
+            vector<PaymentGateway::Result> results;
+            for (const auto& key : keys) {
+                OperationTimer timer(metrics);
+                results.push_back(gateway->lookup(key));
+                if (results.back() == PaymentGateway::Error) timer.fail();
+            }
+            
+            lock.lock();
+            for (size_t i = 0; i < keys.size(); i++) {
+                Payment& payment = payments[keys[i]];
+                if (results[i] == PaymentGateway::Approved) {
+                    payment.state = Charged;
+                    charged.push_back(payment.key);
+                } else if (results[i] == PaymentGateway::Declined) {
+                    settle(payment, Failed);
+                } else {
+                    unknown.push_back(payment.key);
+                }
+            }
+            if (charged.size() >= batchSize) flushWake.notify_one();
+            
+            if (last) return;
+        }
+    }
+    
+    void flushLoop() {
+        chrono::milliseconds backoff = flushInterval;
+        
+        unique_lock<mutex> lock(mtx);
+        while (true) {
+            flushWake.wait_for(lock, flushInterval, [this] { return flusherStopping || charged.size() >= batchSize; });
+            if (charged.empty()) {
+                if (flusherStopping) return;
+                continue;
+            }
+            
+            size_t count = min(charged.size(), batchSize);
+            vector<string> batch(charged.begin(), charged.begin() + count);
+            charged.erase(charged.begin(), charged.begin() + count);
+            
+            vector<int> bookingIds;
+            for (const auto& key : batch) {
+                bookingIds.push_back(payments[key].bookingId);
+            }
+            lock.unlock();
+            
+            bool written = bookingManager->updatePaymentStatuses(bookingIds, "Paid");
+            
+            lock.lock();
+            if (written) {
+                for (const auto& key : batch) {
+                    settle(payments[key], Paid);
+                }
+                backoff = flushInterval;
+            } else {
+                // Keep the batch and back off while the database is failing; on shutdown it
+                // stays Charged
+                if (flusherStopping) return;
+                charged.insert(charged.begin(), batch.begin(), batch.end());
+                flushWake.wait_for(lock, backoff, [this] { return flusherStopping; });
+                backoff = min(backoff * 2, maxFlushBackoff);
+            }
+        }
+    }
+
+public:
+    // Takes ownership of the gateway
+    PaymentSystem(BookingManager* bookingMgr, PaymentGateway* paymentGateway,
+                  size_t workerCount = 4, size_t queueCapacity = 1024)
+        : bookingManager(bookingMgr), gateway(paymentGateway), queueCapacity(queueCapacity),
+          stopping(false), reconcilerStopping(false), flusherStopping(false) {
+        for (size_t i = 0; i < max<size_t>(workerCount, 1); i++) {
+            workers.push_back(thread(&PaymentSystem::workLoop, this));
+        }
+        reconciler = thread(&PaymentSystem::reconcileLoop, this);
+        flusher = thread(&PaymentSystem::flushLoop, this);
+    }
+    
+    // Finishes the payments already queued, looks up unknown outcomes once more, then
+    // records the last batch
+    ~PaymentSystem() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& worker : workers) worker.join();
+        
+        {
+            lock_guard<mutex> lock(mtx);
+            reconcilerStopping = true;
+        }
+        reconcileWake.notify_one();
+        reconciler.join();
+        
+        {
+            lock_guard<mutex> lock(mtx);
+            flusherStopping = true;
+        }
+        flushWake.notify_one();
+        flusher.join();
+    }
+    
+    PaymentSystem(const PaymentSystem&) = delete;
+    PaymentSystem& operator=(const PaymentSystem&) = delete;
+    
+    // Queue a payment, or return the one already recorded under this key. False, with
+    // nothing recorded, if the queue is full.
+    bool submit(const string& key, int bookingId, double amount, const string& method, Payment& payment) {
+        static OperationMetrics& metrics = Metrics::operation("submitPayment");
+        OperationTimer timer(metrics);
+        
+        lock_guard<mutex> lock(mtx);
+        
+        auto it = payments.find(key);
+        if (it != payments.end() && it->second.state != Failed) {
+            payment = it->second;
+            return true;
+        }
+        
+        if (queue.size() >= queueCapacity) {
+            timer.fail();
+            return false;
+        }
+        
+        // A retry keeps the booking the key was first used for
+        bool retry = it != payments.end();
+        Payment& entry = payments[key];
+        if (!retry) {
+            entry.key = key;
+            entry.bookingId = bookingId;
+            entry.attempts = 0;
+        }
+        entry.amount = amount;
+        entry.method = method;
+        entry.state = Queued;
+        
+        queue.push_back(key);
+        workAvailable.notify_one();
+        payment = entry;
+        return true;
+    }
+    
+    bool find(const string& key, Payment& payment) {
+        lock_guard<mutex> lock(mtx);
+        
+        auto it = payments.find(key);
+        if (it == payments.end()) {
+            return false;
+        }
+        payment = it->second;
+        return true;
+    }
+    
+    // Wait up to timeout for the payment to be Paid or Failed; false if the key is unknown
+    bool wait(const string& key, chrono::milliseconds timeout, Payment& payment) {
+        unique_lock<mutex> lock(mtx);
+        
+        // Look the key up after every wake-up, since the entry may expire meanwhile
+        unordered_map<string, Payment>::iterator it;
+        settled.wait_for(lock, timeout, [&] {
+            it = payments.find(key);
+            return it == payments.end() || it->second.state == Paid || it->second.state == Failed;
+        });
+        if (it == payments.end()) {
+            return false;
+        }
+        
+        payment = it->second;
+        return true;
+    }
+    
+    size_t countInState(State state) {
+        lock_guard<mutex> lock(mtx);
+        
+        size_t count = 0;
+        for (const auto& entry : payments) {
+            if (entry.second.state == state) count++;
+        }
+        return count;
+    }
+    
+    static string stateName(State state) {
+        static const char* names[] = { "Queued", "Processing", "Charged", "Paid", "Failed", "Unknown" };
+        return names[state];
+    }
+    
+    // Client keys only have to be unique within a booking, so the same key on another
+    // booking is a different payment
+    static string keyFor(int bookingId, const string& clientKey) {
+        return to_string(bookingId) + ":" + clientKey;
+    }
+    
+    // Default client key: one payment per booking
+    static string defaultKey(int bookingId) {
+        return "booking-" + to_string(bookingId);
+    }
+    
+    static string keyFor(int bookingId) {
+        return keyFor(bookingId, defaultKey(bookingId));
+    }
+    
+    // Menu flow: pay under the booking's own key and wait a few seconds for the outcome
+    bool processPayment(const Booking& booking, const string& paymentMethod) {
+        cout << "Processing payment for booking #" << booking.getBookingId() << " using " << paymentMethod << "...\n";
+        
+        Payment payment;
+        if (!submit(keyFor(booking.getBookingId()), booking.getBookingId(), booking.getTotalFare(), paymentMethod, payment)) {
+            cout << "Payments are busy. Please try again shortly.\n";
+            return false;
+        }
+        
+        wait(payment.key, chrono::milliseconds(5000), payment);
+        
+        if (payment.state == Paid) {
+            cout << "Payment successful!\n";
+            return true;
+        } else if (payment.state == Failed) {
+            cout << "Payment failed. Please try again.\n";
+            return false;
+        } else if (payment.state == Unknown) {
+            cout << "The payment gateway did not confirm this payment. It is being checked; your booking will show as Paid if the charge went through. Please do not pay again.\n";
+            return true;
+        }
+        
+        cout << "Payment is still processing; your booking will show as Paid once it completes.\n";
+        return true;
+    }
+    
+    void displayPaymentOptions() {
+        cout << "\n------ Payment Options ------\n";
+        cout << "1. Credit Card\n";
+        cout << "2. Debit Card\n";
+        cout << "3. Net Banking\n";
+        cout << "4. UPI Payment\n";
+        cout << "5. Cancel Payment\n";
+    }
+};
+
+// ============= MENU SYSTEM =============
+class Menu {
+private:
+    StorageBackend* storage;
+    UserManager* userManager;
+    TrainManager* trainManager;
+    BookingManager* bookingManager;
+    PaymentSystem* paymentSystem;
+    User* currentUser;
+    
+    void displayMainMenu() const {
+        Utility::clearScreen();
+        cout << "\n===== RAILWAY TICKET BOOKING SYSTEM =====\n";
+        cout << "1. Login\n";
+        cout << "2. Register\n";
+        cout << "3. Exit\n";
+        cout << "Choose an option: ";
+    }
+    
+    void displayUserMenu() const {
+        Utility::clearScreen();
+        cout << "\n===== Welcome, " << currentUser->getName() << "! =====\n";
+        cout << "1. Search Trains\n";
+        cout << "2. View All Trains\n";
+        cout << "3. Book Ticket\n";
+        cout << "4. View My Bookings\n";
+        cout << "5. Cancel Booking\n";
+        cout << "6. Update Profile\n";
+        cout << "7. Change Password\n";
+        cout << "8. Plan Journey\n";
+        cout << "9. Seat Availability Calendar\n";
+        cout << "10. Logout\n";
+        cout << "Choose an option: ";
+    }
+    
+    void registerUser() {
+        Utility::clearScreen();
+        cout << "\n===== USER REGISTRATION =====\n";
+        
+        string username = Utility::getInput("Enter username: ");
+        string password = Utility::getInput("Enter password: ");
+        string fullName = Utility::getInput("Enter full name: ");
+        string email = Utility::getInput("Enter email: ");
+        string phone = Utility::getInput("Enter phone number: ");
+        
+        User newUser(0, username, password, fullName, email, phone, Utility::getCurrentDate());
+        
+        if (userManager->registerUser(newUser)) {
+            cout << "Registration successful! You can now login.\n";
+        } else {
+            cout << "Registration failed. Username or email might already exist.\n";
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+    bool loginUser() {
+        Utility::clearScreen();
+        cout << "\n===== USER LOGIN =====\n";
+        
+        string username = Utility::getInput("Enter username: ");
+        string password = Utility::getInput("Enter password: ");
+        
+        currentUser = userManager->loginUser(username, password);
+        
+        if (currentUser) {
+            cout << "Login successful! Welcome, " << currentUser->getName() << "!\n";
+            Utility::pressEnterToContinue();
+            return true;
+        } else {
+            cout << "Login failed. Invalid username or password.\n";
+            Utility::pressEnterToContinue();
+            return false;
+        }
+    }
+    
+    void searchTrains() {
+        Utility::clearScreen();
+        cout << "\n===== SEARCH TRAINS =====\n";
+        
+        string source = Utility::getInput("Enter source station (or part of name): ");
+        string destination = Utility::getInput("Enter destination station (or part of name): ");
+        
+        vector<Train> trains = trainManager->searchTrains(source, destination);
+        
+        if (trains.empty()) {
+            cout << "No trains found matching your criteria.\n";
+            
+            // Offer close station names in case of a typo
+            const string* typed[2] = { &source, &destination };
+            for (const string* text : typed) {
+                if (text->empty()) continue;
+                
+                vector<string> suggestions = trainManager->completeStation(*text);
+                if (!suggestions.empty()) {
+                    cout << "Stations matching \"" << *text << "\":";
+                    for (const auto& name : suggestions) {
+                        cout << " " << name;
+                    }
+                    cout << endl;
+                }
+            }
+        } else {
+            // One adult fare per train, quoted for the whole page at once
+            string journeyDate = Utility::getInput("Journey date for fares (YYYY-MM-DD, blank for today): ");
+            if (journeyDate.empty()) {
+                journeyDate = Utility::getCurrentDate();
+            }
+            vector<double> fares = trainManager->quoteFares(trains, journeyDate, vector<int>(1, -1));
+            
+            cout << "\nFound " << trains.size() << " train(s):\n";
+            Train::displayHeader(true);
+            
+            for (size_t i = 0; i < trains.size(); i++) {
+                trains[i].displayInfo(fares[i]);
+            }
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+    void planJourney() {
+        Utility::clearScreen();
+        cout << "\n===== PLAN JOURNEY =====\n";
+        
+        string source = Utility::getInput("Enter source station (or part of name): ");
+        string destination = Utility::getInput("Enter destination station (or part of name): ");
+        
+        if (source.empty() || destination.empty()) {
+            cout << "Please enter both stations.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        string time = Utility::getInput("Leave after (HH:MM, blank for midnight): ");
+        int departAfter = time.empty() ? 0 : Utility::minutesOfDay(time);
+        if (departAfter < 0) {
+            cout << "Invalid time. Please try again.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        vector<Journey> journeys = trainManager->planJourneys(source, destination, departAfter, 2);
+        
+        if (journeys.empty()) {
+            cout << "No journey found with up to 2 changes.\n";
+        }
+        
+        for (const auto& journey : journeys) {
+            cout << "\n" << Journey::formatTime(journey.departure()) << " -> " << Journey::formatTime(journey.arrival())
+                 << " (" << journey.transfers() << (journey.transfers() == 1 ? " change" : " changes") << ")\n";
+            
+            for (const auto& leg : journey.legs) {
+                cout << "  " << left << setw(8) << Journey::formatTime(leg.departure)
+                     << setw(20) << leg.train->getSource() << setw(8) << Journey::formatTime(leg.arrival)
+                     << setw(20) << leg.train->getDestination()
+                     << leg.train->getTrainName() << " (" << leg.train->getTrainId() << ")\n";
+            }
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+    void viewAvailabilityCalendar() {
+        Utility::clearScreen();
+        cout << "\n===== SEAT AVAILABILITY CALENDAR =====\n";
+        
+        string source = Utility::getInput("Enter source station (or part of name): ");
+        string destination = Utility::getInput("Enter destination station (or part of name): ");
+        vector<Train> trains = trainManager->searchTrains(source, destination);
+        
+        if (trains.empty()) {
+            cout << "No trains found matching your criteria.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        string firstDate = Utility::getInput("First date (YYYY-MM-DD, blank for today): ");
+        if (firstDate.empty()) {
+            firstDate = Utility::getCurrentDate();
+        }
+        
+        long firstDay;
+        int days = Utility::getIntInput("Number of days (1-31): ");
+        if (!Utility::dayNumber(Utility::normalizeDate(firstDate), firstDay) || days < 1 || days > 31) {
+            cout << "Invalid date or number of days. Please try again.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        vector<int> trainIds;
+        for (const auto& train : trains) {
+            trainIds.push_back(train.getTrainId());
+        }
+        vector<vector<int>> calendar = trainManager->getAvailabilityCalendar(trainIds, firstDate, days);
+        
+        // One row per train, one MM-DD column per date
+        cout << "\nSeats available for the whole route:\n";
+        cout << left << setw(5) << "ID" << setw(20) << "Train Name";
+        for (int d = 0; d < days; d++) {
+            cout << setw(7) << Utility::dateFromDayNumber(firstDay + d).substr(5);
+        }
+        cout << endl;
+        
+        for (size_t t = 0; t < trains.size(); t++) {
+            cout << left << setw(5) << trains[t].getTrainId() << setw(20) << trains[t].getTrainName().substr(0, 19);
+            for (int seats : calendar[t]) {
+                cout << setw(7) << seats;
+            }
+            cout << endl;
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+    void viewAllTrains() {
+        Utility::clearScreen();
+        cout << "\n===== ALL AVAILABLE TRAINS =====\n";
+        
+        vector<Train> trains = trainManager->getAllTrains();
+        
+        if (trains.empty()) {
+            cout << "No trains available in the system.\n";
+        } else {
+            cout << "\nTotal " << trains.size() << " train(s):\n";
+            Train::displayHeader();
+            
+            for (const auto& train : trains) {
+                train.displayInfo();
+            }
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+    void bookTicket() {
+        Utility::clearScreen();
+        cout << "\n===== BOOK TRAIN TICKET =====\n";
+        
+        // First, show all available trains
+        vector<Train> trains = trainManager->getAllTrains();
+        
+        if (trains.empty()) {
+            cout << "No trains available for booking.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        cout << "\nAvailable Trains:\n";
+        Train::displayHeader();
+        
+        for (const auto& train : trains) {
+            train.displayInfo();
+        }
+        
+        int trainId = Utility::getIntInput("\nEnter Train ID to book: ");
+        
+        // Check if train exists
+        shared_ptr<const Train> selectedTrain = trainManager->getTrainById(trainId);
+        if (!selectedTrain) {
+            cout << "Invalid Train ID. Please try again.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        string journeyDate = Utility::getInput("Enter journey date (YYYY-MM-DD): ");
+        
+        // Trains with intermediate stops can be booked for part of the route
+        int fromStop = 0;
+        int toStop = selectedTrain->getStopCount() - 1;
+        if (selectedTrain->getStopCount() > 2) {
+            vector<TrainStop> route = selectedTrain->getStops();
+            cout << "\nStops:";
+            for (size_t i = 0; i < route.size(); i++) {
+                cout << (i ? " -> " : " ") << route[i].station;
+            }
+            cout << endl;
+            
+            string boarding = Utility::getInput("Board at (Enter for " + route.front().station + "): ");
+            string alighting = Utility::getInput("Leave at (Enter for " + route.back().station + "): ");
+            fromStop = boarding.empty() ? 0 : selectedTrain->findStop(boarding);
+            toStop = alighting.empty() ? toStop : selectedTrain->findStop(alighting);
+            
+            if (fromStop < 0 || toStop < 0 || fromStop >= toStop) {
+                cout << "Invalid stops. Please try again.\n";
+                Utility::pressEnterToContinue();
+                return;
+            }
+        }
+        
+        // Check available seats; the seat map is loaded alongside for the booking itself
+        trainManager->prepareBooking(trainId, journeyDate);
+        int availableSeats = trainManager->getAvailableSeats(trainId, journeyDate, fromStop, toStop);
+        cout << "Available seats: " << availableSeats << endl;
+        
+        int numPassengers = Utility::getIntInput("Enter number of passengers: ");
+        
+        if (numPassengers <= 0 || numPassengers > selectedTrain->getTotalSeats()) {
+            cout << "Invalid number of passengers. Please try again.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        bool waitlistIfFull = false;
+        if (numPassengers > availableSeats) {
+            cout << "Not enough seats are available. Join the waitlist? (y/n): ";
+            string choice;
+            getline(cin, choice);
+            
+            if (choice != "y" && choice != "Y") {
+                Utility::pressEnterToContinue();
+                return;
+            }
+            waitlistIfFull = true;
+        }
+        
+        // Create booking
+        Booking newBooking(
+            0, currentUser->getUserId(), trainId, Utility::getCurrentDate(), journeyDate,
+            numPassengers, 0.0, "Confirmed", "Pending"
+        );
+        newBooking.setStops(fromStop, toStop);
+        
+        // Add passenger details
+        cout << "\nEnter passenger details:\n";
+        
+        for (int i = 0; i < numPassengers; i++) {
+            cout << "\nPassenger " << (i + 1) << ":\n";
+            string name = Utility::getInput("Name: ");
+            int age = Utility::getIntInput("Age: ");
+            string gender = Utility::getInput("Gender (Male/Female/Other): ");
+            
+            // Seat numbers are assigned by the seat allocator when the booking is saved
+            Passenger passenger(0, name, age, gender);
+            newBooking.addPassenger(passenger);
+        }
+        
+        // Save booking
+        bool created = bookingManager->createBooking(newBooking, waitlistIfFull);
+        
+        if (created && newBooking.getBookingId() == 0) {
+            // Journaled but not stored yet, so there is no booking ID to pay against
+            cout << "\nYour booking is saved and will appear under My Bookings shortly.\n";
+        } else if (created && newBooking.getBookingStatus() == "Waiting") {
+            cout << "\nAdded to the waitlist. Booking ID: " << newBooking.getBookingId() << endl;
+            cout << "The booking is confirmed automatically when enough seats are freed.\n";
+        } else if (created) {
+            cout << "\nBooking created successfully! Booking ID: " << newBooking.getBookingId() << endl;
+            cout << "Total fare: $" << fixed << setprecision(2) << newBooking.getTotalFare() << endl;
+            cout << "Seats:";
+            for (const auto& passenger : newBooking.getPassengers()) {
+                cout << " " << passenger.getSeatNumber();
+            }
+            cout << endl;
+            
+            // Process payment
+            cout << "\nProceed to payment? (y/n): ";
+            string choice;
+            getline(cin, choice);
+            
+            if (choice == "y" || choice == "Y") {
+                paymentSystem->displayPaymentOptions();
+                int paymentOption = Utility::getIntInput("Select payment method: ");
+                
+                string paymentMethod;
+                switch (paymentOption) {
+                    case 1: paymentMethod = "Credit Card"; break;
+                    case 2: paymentMethod = "Debit Card"; break;
+                    case 3: paymentMethod = "Net Banking"; break;
+                    case 4: paymentMethod = "UPI Payment"; break;
+                    default: 
+                        cout << "Payment cancelled.\n";
+                        Utility::pressEnterToContinue();
+                        return;
+                }
+                
+                paymentSystem->processPayment(newBooking, paymentMethod);
+            }
+        } else {
+            cout << "Booking failed. Please try again.\n";
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+    void viewMyBookings() {
+        Utility::clearScreen();
+        cout << "\n===== MY BOOKINGS =====\n";
+        
+        vector<Booking> bookings = bookingManager->getUserBookings(currentUser->getUserId());
+        
+        if (bookings.empty()) {
+            cout << "You don't have any bookings yet.\n";
+        } else {
+            cout << "You have " << bookings.size() << " booking(s):\n\n";
+            
+            for (const auto& booking : bookings) {
+                shared_ptr<const Train> train = trainManager->getTrainById(booking.getTrainId());
+                if (train) {
+                    booking.displayInfo(*train);
+                }
+                cout << "\n" << string(40, '-') << "\n";
+            }
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+    void cancelBooking() {
+        Utility::clearScreen();
+        cout << "\n===== CANCEL BOOKING =====\n";
+        
+        vector<Booking> bookings = bookingManager->getUserBookings(currentUser->getUserId());
+        
+        if (bookings.empty()) {
+            cout << "You don't have any bookings to cancel.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        cout << "Your active bookings:\n\n";
+        cout << left << setw(10) << "BookingID" 
+             << setw(15) << "Journey Date" 
+             << setw(10) << "Train" 
+             << setw(8) << "Status" << endl;
+        cout << string(43, '-') << endl;
+        
+        for (const auto& booking : bookings) {
+            if (booking.getBookingStatus() != "Cancelled") {
+                shared_ptr<const Train> train = trainManager->getTrainById(booking.getTrainId());
+                
+                cout << left << setw(10) << booking.getBookingId()
+                     << setw(15) << booking.getJourneyDate()
+                     << setw(10) << (train ? train->getTrainNumber() : "Unknown")
+                     << setw(8) << booking.getBookingStatus() << endl;
+            }
+        }
+        
+        int bookingId = Utility::getIntInput("\nEnter Booking ID to cancel (0 to go back): ");
+        
+        if (bookingId == 0) return;
+        
+        bool found = false;
+        for (const auto& booking : bookings) {
+            if (booking.getBookingId() == bookingId && booking.getBookingStatus() != "Cancelled") {
+                found = true;
+                break;
+            }
+        }
+        
+        if (!found) {
+            cout << "Invalid Booking ID or booking already cancelled.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        cout << "Are you sure you want to cancel booking #" << bookingId << "? (y/n): ";
+        string choice;
+        getline(cin, choice);
+        
+        if (choice == "y" || choice == "Y") {
+            if (bookingManager->cancelBooking(bookingId)) {
+                cout << "Booking cancelled successfully.\n";
+                cout << "A refund will be processed according to the cancellation policy.\n";
+            } else {
+                cout << "Failed to cancel booking. Please try again.\n";
+            }
+        } else {
+            cout << "Cancellation aborted.\n";
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+    void updateProfile() {
+        Utility::clearScreen();
+        cout << "\n===== UPDATE PROFILE =====\n";
+        
+        currentUser->displayInfo();
+        cout << "\nEnter new details (leave blank to keep current value):\n";
+        
+        string fullName = Utility::getInput("Full Name: ");
+        string email = Utility::getInput("Email: ");
+        string phone = Utility::getInput("Phone: ");
+        
+        if (!fullName.empty()) currentUser->setName(fullName);
+        if (!email.empty()) currentUser->setEmail(email);
+        if (!phone.empty()) currentUser->setPhone(phone);
+        
+        if (userManager->updateUserProfile(*currentUser)) {
+            cout << "Profile updated successfully!\n";
+        } else {
+            cout << "Failed to update profile. Please try again.\n";
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+    void changePassword() {
+        Utility::clearScreen();
+        cout << "\n===== CHANGE PASSWORD =====\n";
+        
+        string currentPassword = Utility::getInput("Enter current password: ");
+        
+        if (currentPassword != currentUser->getPassword()) {
+            cout << "Incorrect current password.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        string newPassword = Utility::getInput("Enter new password: ");
+        string confirmPassword = Utility::getInput("Confirm new password: ");
+        
+        if (newPassword != confirmPassword) {
+            cout << "Passwords do not match.\n";
+            Utility::pressEnterToContinue();
+            return;
+        }
+        
+        if (userManager->changePassword(currentUser->getUserId(), newPassword)) {
+            // Update current user's password in memory
+            currentUser->setPassword(newPassword);
+            cout << "Password changed successfully!\n";
+        } else {
+            cout << "Failed to change password. Please try again.\n";
+        }
+        
+        Utility::pressEnterToContinue();
+    }
+    
+public:
+    Menu() : Menu(new MySqlBackend()) {}
+    
+    // Takes ownership of the backend
+    Menu(StorageBackend* backend) {
+        storage = backend;
+        userManager = new UserManager(storage->users());
+        trainManager = new TrainManager(storage->trains(), storage->queryExecutor());
+        bookingManager = new BookingManager(storage->bookings(), storage->passengers(), trainManager);
+        paymentSystem = new PaymentSystem(bookingManager, new SimulatedPaymentGateway());
+        currentUser = nullptr;
+    }
+    
+    ~Menu() {
+        delete paymentSystem; // Finishes queued payments, so it goes before the managers
+        delete userManager;
+        delete trainManager;
+        delete bookingManager;
+        delete currentUser;
+        delete storage;
+    }
+    
+    void run() {
+        int choice;
+        bool running = true;
+        
+        while (running) {
+            if (!currentUser) {
+                // Main menu (not logged in)
+                displayMainMenu();
+                choice = Utility::getIntInput("");
+                
+                switch (choice) {
+                    case 1: // Login
+                        if (loginUser()) {
+                            runUserMenu();
+                        }
+                        break;
+                    case 2: // Register
+                        registerUser();
+                        break;
+                    case 3: // Exit
+                        running = false;
+                        cout << "Thank you for using Railway Ticket Booking System. Goodbye!\n";
+                        break;
+                    default:
+                        cout << "Invalid choice. Please try again.\n";
+                        Utility::pressEnterToContinue();
+                }
+            } else {
+                runUserMenu();
+                // User logged out
+                currentUser = nullptr;
+            }
+        }
+    }
+    
+    void runUserMenu() {
+        int choice;
+        bool userLoggedIn = true;
+        
+        while (userLoggedIn) {
+            displayUserMenu();
+            choice = Utility::getIntInput("");
+            
+            switch (choice) {
+                case 1: // Search Trains
+                    searchTrains();
+                    break;
+                case 2: // View All Trains
+                    viewAllTrains();
+                    break;
+                case 3: // Book Ticket
+                    bookTicket();
+                    break;
+                case 4: // View My Bookings
+                    viewMyBookings();
+                    break;
+                case 5: // Cancel Booking
+                    cancelBooking();
+                    break;
+                case 6: // Update Profile
+                    updateProfile();
+                    break;
+                case 7: // Change Password
+                    changePassword();
+                    break;
+                case 8: // Plan Journey
+                    planJourney();
+                    break;
+                case 9: // Seat Availability Calendar
+                    viewAvailabilityCalendar();
+                    break;
+                case 10: // Logout
+                    userLoggedIn = false;
+                    cout << "Logged out successfully.\n";
+                    Utility::pressEnterToContinue();
+                    break;
+                default:
+                    cout << "Invalid choice. Please try again.\n";
+                    Utility::pressEnterToContinue();
+            }
+        }
+    }
+};
+
+// ============= COMMAND MODE =============
+// Line-oriented commands run straight through the managers, used by batch mode and
+// the network server. One command per line; arguments containing spaces go in
+// double quotes:
+//
+//   register <username> <password> <full name> <email> <phone>
+//   login <username> <password>
+//   auth <token>
+//   logout
+//   search <source> <destination> [journey date]
+//   plan <source> <destination> [HH:MM] [max transfers]
+//   stops <train id>
+//   seats <train id> <journey date> [from station] [to station]
+//   calendar <source> <destination> <first date> [days]
+//   book|waitlist <train id> <journey date> [from=<station>] [to=<station>] <name:age:gender> [<name:age:gender> ...]
+//   cancel <booking id>
+//   pay <booking id> [method] [key=<idempotency key>]
+//   payment <booking id> [key=<idempotency key>] [wait]
+//   bookings
+//
+// Blank lines and lines starting with '#' are skipped. Each command writes exactly one
+// line: "ok <command> key=value..." or "error <line number> <command>: <reason>".
+// login returns a session token; auth resumes that session on another connection.
+// pay queues the payment and returns at once; payment reports how it went.
+// The managers are shared, so one interpreter serves any number of sessions at once.
+class CommandInterpreter {
+public:
+    // Per-client state: the session token, who it was last checked to belong to, and how
+    // far through the input we are
+    struct Session {
+        string token;
+        shared_ptr<const User> currentUser;
+        int lineNumber;
+        int errors;
+        
+        Session() : lineNumber(0), errors(0) {}
+    };
+
+private:
+    StorageBackend* storage;
+    UserManager* userManager;
+    TrainManager* trainManager;
+    BookingManager* bookingManager;
+    PaymentSystem* paymentSystem;
+    
+    // Thrown by a command to report a failure for its line
+    struct CommandError {
+        string message;
+        CommandError(const string& message) : message(message) {}
+    };
+    
+    static vector<string> tokenize(const string& line) {
+        vector<string> tokens;
+        string token;
+        bool inQuotes = false, inToken = false;
+        
+        for (char c : line) {
+            if (c == '"') {
+                inQuotes = !inQuotes;
+                inToken = true;
+            } else if (!inQuotes && isspace((unsigned char)c)) {
+                if (inToken) tokens.push_back(token);
+                token.clear();
+                inToken = false;
+            } else {
+                token += c;
+                inToken = true;
+            }
+        }
+        if (inQuotes) throw CommandError("unterminated quote");
+        if (inToken) tokens.push_back(token);
+        
+        return tokens;
+    }
+    
+    static int toInt(const string& text, const string& what) {
+        char* end = nullptr;
+        long value = strtol(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0' || value < INT_MIN || value > INT_MAX) {
+            throw CommandError("invalid " + what + " '" + text + "'");
+        }
+        return (int)value;
+    }
+    
+    static int stopOf(const Train& train, const string& station) {
+        int stop = train.findStop(station);
+        if (stop < 0) throw CommandError("train " + to_string(train.getTrainId()) + " does not stop at " + station);
+        return stop;
+    }
+    
+    static void expectArgs(const vector<string>& args, size_t min, size_t max, const string& usage) {
+        if (args.size() - 1 < min || args.size() - 1 > max) {
+            throw CommandError("usage: " + usage);
+        }
+    }
+    
+    // Every command that needs a login checks the token again, so an expired or
+    // revoked session stops working at once; the check touches no storage
+    void requireLogin(Session& session) {
+        if (session.token.empty()) throw CommandError("not logged in");
+        
+        session.currentUser = userManager->authenticate(session.token);
+        if (!session.currentUser) {
+            session.token.clear();
+            throw CommandError("session expired");
+        }
+    }
+    
+    // The logged-in user's booking, which must not be cancelled
+    Booking ownActiveBooking(const Session& session, const string& idText) {
+        int bookingId = toInt(idText, "booking id");
+        unique_ptr<Booking> booking(bookingManager->getBookingById(bookingId));
+        
+        if (!booking || booking->getUserId() != session.currentUser->getUserId()) {
+            throw CommandError("no booking " + idText);
+        }
+        if (booking->getBookingStatus() == "Cancelled") {
+            throw CommandError("booking " + idText + " is cancelled");
+        }
+        return *booking;
+    }
+    
+    string execute(Session& session, const vector<string>& args) {
+        const string& command = args[0];
+        ostringstream result;
+        
+        if (command == "register") {
+            expectArgs(args, 5, 5, "register <username> <password> <full name> <email> <phone>");
+            User user(0, args[1], args[2], args[3], args[4], args[5], Utility::getCurrentDate());
+            if (!userManager->registerUser(user)) throw CommandError("registration failed");
+            result << "user_id=" << user.getUserId();
+        } else if (command == "login") {
+            expectArgs(args, 2, 2, "login <username> <password>");
+            unique_ptr<User> user(userManager->loginUser(args[1], args[2]));
+            if (!user) throw CommandError("invalid username or password");
+            if (!session.token.empty()) userManager->endSession(session.token);
+            
+            session.token = userManager->startSession(*user);
+            session.currentUser = shared_ptr<const User>(user.release());
+            result << "user_id=" << session.currentUser->getUserId() << " token=" << session.token;
+        } else if (command == "auth") {
+            // Resume a session started elsewhere, e.g. on another connection
+            expectArgs(args, 1, 1, "auth <token>");
+            shared_ptr<const User> user = userManager->authenticate(args[1]);
+            if (!user) throw CommandError("invalid or expired token");
+            
+            session.token = args[1];
+            session.currentUser = user;
+            result << "user_id=" << user->getUserId();
+        } else if (command == "logout") {
+            expectArgs(args, 0, 0, "logout");
+            requireLogin(session);
+            userManager->endSession(session.token);
+            session.token.clear();
+            session.currentUser.reset();
+        } else if (command == "search") {
+            expectArgs(args, 2, 3, "search <source> <destination> [journey date]");
+            result << "trains=";
+            vector<Train> trains = trainManager->searchTrains(args[1], args[2]);
+            for (size_t i = 0; i < trains.size(); i++) {
+                result << (i ? "," : "") << trains[i].getTrainId();
+            }
+            
+            // With a date, also the adult fare on each train, in the same order
+            if (args.size() > 3) {
+                vector<double> fares = trainManager->quoteFares(trains, args[3], vector<int>(1, -1));
+                result << " fares=" << fixed << setprecision(2);
+                for (size_t i = 0; i < fares.size(); i++) {
+                    result << (i ? "," : "") << fares[i];
+                }
+            }
+        } else if (command == "plan") {
+            expectArgs(args, 2, 4, "plan <source> <destination> [HH:MM] [max transfers]");
+            if (args[1].empty() || args[2].empty()) throw CommandError("stations must not be empty");
+            int departAfter = args.size() > 3 ? Utility::minutesOfDay(args[3]) : 0;
+            if (departAfter < 0) throw CommandError("time must be HH:MM");
+            int maxTransfers = args.size() > 4 ? toInt(args[4], "max transfers") : 2;
+            if (maxTransfers < 0 || maxTransfers > 5) throw CommandError("max transfers must be 0 to 5");
+            
+            // Each journey: train IDs joined by '+', then @departure-arrival
+            vector<Journey> journeys = trainManager->planJourneys(args[1], args[2], departAfter, maxTransfers);
+            result << "journeys=" << journeys.size();
+            for (const auto& journey : journeys) {
+                result << " ";
+                for (size_t i = 0; i < journey.legs.size(); i++) {
+                    result << (i ? "+" : "") << journey.legs[i].train->getTrainId();
+                }
+                result << "@" << Journey::formatTime(journey.departure()) << "-" << Journey::formatTime(journey.arrival());
+            }
+        } else if (command == "stops") {
+            expectArgs(args, 1, 1, "stops <train id>");
+            shared_ptr<const Train> train = trainManager->getTrainById(toInt(args[1], "train id"));
+            if (!train) throw CommandError("no train " + args[1]);
+            
+            vector<TrainStop> route = train->getStops();
+            result << "stops=";
+            for (size_t i = 0; i < route.size(); i++) {
+                result << (i ? "," : "") << route[i].station;
+            }
+        } else if (command == "seats") {
+            expectArgs(args, 2, 4, "seats <train id> <journey date> [from station] [to station]");
+            shared_ptr<const Train> train = trainManager->getTrainById(toInt(args[1], "train id"));
+            if (!train) throw CommandError("no train " + args[1]);
+            
+            int fromStop = args.size() > 3 ? stopOf(*train, args[3]) : 0;
+            int toStop = args.size() > 4 ? stopOf(*train, args[4]) : train->getStopCount() - 1;
+            if (fromStop >= toStop) throw CommandError("stops must be in travel order");
+            result << "available=" << trainManager->getAvailableSeats(train->getTrainId(), args[2], fromStop, toStop);
+        } else if (command == "calendar") {
+            expectArgs(args, 3, 4, "calendar <source> <destination> <first date> [days]");
+            long firstDay;
+            if (!Utility::dayNumber(Utility::normalizeDate(args[3]), firstDay)) throw CommandError("date must be YYYY-MM-DD");
+            int days = args.size() > 4 ? toInt(args[4], "days") : 7;
+            if (days < 1 || days > 366) throw CommandError("days must be 1 to 366");
+            
+            vector<int> trainIds;
+            for (const auto& train : trainManager->searchTrains(args[1], args[2])) {
+                trainIds.push_back(train.getTrainId());
+            }
+            vector<vector<int>> calendar = trainManager->getAvailabilityCalendar(trainIds, args[3], days);
+            
+            // Per train: id, then the seats left on each date, trains separated by ';'
+            result << "dates=" << Utility::dateFromDayNumber(firstDay) << ".."
+                   << Utility::dateFromDayNumber(firstDay + days - 1) << " available=";
+            for (size_t t = 0; t < trainIds.size(); t++) {
+                result << (t ? ";" : "") << trainIds[t] << ":";
+                for (int d = 0; d < days; d++) {
+                    result << (d ? "," : "") << calendar[t][d];
+                }
+            }
+        } else if (command == "book" || command == "waitlist") {
+            expectArgs(args, 3, numeric_limits<size_t>::max(),
+                       command + " <train id> <journey date> [from=<station>] [to=<station>] <name:age:gender>...");
+            requireLogin(session);
+            
+            shared_ptr<const Train> train = trainManager->getTrainById(toInt(args[1], "train id"));
+            if (!train) throw CommandError("no train " + args[1]);
+            
+            // Optional boarding and leaving stations come before the passengers
+            int fromStop = 0;
+            int toStop = train->getStopCount() - 1;
+            size_t firstPassenger = 3;
+            for (; firstPassenger < args.size(); firstPassenger++) {
+                const string& arg = args[firstPassenger];
+                if (arg.compare(0, 5, "from=") == 0) {
+                    fromStop = stopOf(*train, arg.substr(5));
+                } else if (arg.compare(0, 3, "to=") == 0) {
+                    toStop = stopOf(*train, arg.substr(3));
+                } else {
+                    break;
+                }
+            }
+            if (fromStop >= toStop) throw CommandError("stops must be in travel order");
+            if (firstPassenger == args.size()) throw CommandError("at least one passenger is required");
+            
+            Booking booking(0, session.currentUser->getUserId(), train->getTrainId(), Utility::getCurrentDate(), args[2],
+                            (int)(args.size() - firstPassenger), 0.0, "Confirmed", "Pending");
+            booking.setStops(fromStop, toStop);
+            
+            for (size_t i = firstPassenger; i < args.size(); i++) {
+                size_t first = args[i].find(':');
+                size_t second = first == string::npos ? string::npos : args[i].find(':', first + 1);
+                if (second == string::npos) throw CommandError("passenger must be name:age:gender");
+                
+                booking.addPassenger(Passenger(0, args[i].substr(0, first),
+                                               toInt(args[i].substr(first + 1, second - first - 1), "age"),
+                                               args[i].substr(second + 1)));
+            }
+            
+            // waitlist queues the booking instead of failing when the train is full
+            if (!bookingManager->createBooking(booking, command == "waitlist")) throw CommandError("booking failed");
+            
+            // Booking ID 0 means the booking was journaled and is stored in the background
+            result << "booking_id=" << booking.getBookingId() << " status=" << booking.getBookingStatus()
+                   << " fare=" << fixed << setprecision(2) << booking.getTotalFare() << " seats=";
+            for (size_t i = 0; i < booking.getPassengers().size(); i++) {
+                result << (i ? "," : "") << booking.getPassengers()[i].getSeatNumber();
+            }
+        } else if (command == "cancel") {
+            expectArgs(args, 1, 1, "cancel <booking id>");
+            requireLogin(session);
+            Booking booking = ownActiveBooking(session, args[1]);
+            if (!bookingManager->cancelBooking(booking.getBookingId())) throw CommandError("cancellation failed");
+            result << "booking_id=" << booking.getBookingId();
+        } else if (command == "pay") {
+            expectArgs(args, 1, 3, "pay <booking id> [method] [key=<idempotency key>]");
+            requireLogin(session);
+            Booking booking = ownActiveBooking(session, args[1]);
+            if (booking.getPaymentStatus() == "Paid") throw CommandError("booking " + args[1] + " is already paid");
+            
+            string method = "Credit Card";
+            string key = PaymentSystem::defaultKey(booking.getBookingId());
+            for (size_t i = 2; i < args.size(); i++) {
+                if (args[i].compare(0, 4, "key=") == 0) key = args[i].substr(4);
+                else method = args[i];
+            }
+            if (key.empty()) throw CommandError("idempotency key must not be empty");
+            
+            // A retry with the same key reports the payment already made instead of paying again
+            PaymentSystem::Payment payment;
+            if (!paymentSystem->submit(PaymentSystem::keyFor(booking.getBookingId(), key), booking.getBookingId(),
+                                       booking.getTotalFare(), method, payment)) {
+                throw CommandError("payment queue is full, retry with the same key");
+            }
+            result << "booking_id=" << booking.getBookingId() << " key=" << key
+                   << " status=" << PaymentSystem::stateName(payment.state);
+        } else if (command == "payment") {
+            const string usage = "payment <booking id> [key=<idempotency key>] [wait]";
+            expectArgs(args, 1, 3, usage);
+            requireLogin(session);
+            
+            // Only the booking's owner may see its payments
+            int bookingId = toInt(args[1], "booking id");
+            unique_ptr<Booking> booking(bookingManager->getBookingById(bookingId));
+            if (!booking || booking->getUserId() != session.currentUser->getUserId()) {
+                throw CommandError("no booking " + args[1]);
+            }
+            
+            string key = PaymentSystem::defaultKey(bookingId);
+            bool wait = false;
+            for (size_t i = 2; i < args.size(); i++) {
+                if (args[i].compare(0, 4, "key=") == 0) key = args[i].substr(4);
+                else if (args[i] == "wait") wait = true;
+                else throw CommandError("usage: " + usage);
+            }
+            
+            PaymentSystem::Payment payment;
+            string scopedKey = PaymentSystem::keyFor(bookingId, key);
+            bool found = wait ? paymentSystem->wait(scopedKey, chrono::milliseconds(30000), payment)
+                              : paymentSystem->find(scopedKey, payment);
+            if (!found) throw CommandError("no payment " + key + " for booking " + args[1]);
+            
+            result << "booking_id=" << payment.bookingId << " status=" << PaymentSystem::stateName(payment.state)
+                   << " attempts=" << payment.attempts;
+        } else if (command == "bookings") {
+            expectArgs(args, 0, 0, "bookings");
+            requireLogin(session);
+            vector<Booking> bookings = bookingManager->getUserBookings(session.currentUser->getUserId());
+            result << "count=" << bookings.size();
+            for (const auto& booking : bookings) {
+                result << " " << booking.getBookingId() << ":" << booking.getBookingStatus()
+                       << ":" << booking.getPaymentStatus();
+            }
+        } else {
+            throw CommandError("unknown command");
+        }
+        
+        string fields = result.str();
+        return "ok " + command + (fields.empty() ? "" : " " + fields);
+    }
+
+public:
+    // Takes ownership of the backend
+    CommandInterpreter(StorageBackend* backend) {
+        storage = backend;
+        userManager = new UserManager(storage->users());
+        trainManager = new TrainManager(storage->trains(), storage->queryExecutor());
+        bookingManager = new BookingManager(storage->bookings(), storage->passengers(), trainManager);
+        paymentSystem = new PaymentSystem(bookingManager, new SimulatedPaymentGateway());
+    }
+    
+    ~CommandInterpreter() {
+        delete paymentSystem;
+        delete userManager;
+        delete trainManager;
+        delete bookingManager;
+        delete storage;
+    }
+    
+    // Run one input line; false for blank and comment lines, which have no response
+    bool execute(Session& session, const string& line, string& response) {
+        session.lineNumber++;
+        string command;
+        
+        try {
+            vector<string> args = tokenize(line);
+            if (args.empty() || args[0][0] == '#') return false;
+            
+            command = args[0];
+            response = execute(session, args);
+        } catch (const CommandError& e) {
+            response = "error " + to_string(session.lineNumber) + " " +
+                       (command.empty() ? "" : command + ": ") + e.message;
+            session.errors++;
+        }
+        
+        return true;
+    }
+};
+
+// Runs a command stream from a file or stdin without prompts or screen clears.
+// Messages the managers print themselves go to stderr.
+class BatchRunner {
+public:
+    // Returns the number of failed commands
+    static int run(CommandInterpreter& interpreter, istream& in, ostream& out) {
+        // Keep manager chatter off the result stream; out may be cout itself, so
+        // results go through a stream bound to its original buffer
+        ostream results(out.rdbuf());
+        streambuf* console = cout.rdbuf(cerr.rdbuf());
+        
+        CommandInterpreter::Session session;
+        string line, response;
+        
+        while (getline(in, line)) {
+            if (interpreter.execute(session, line, response)) {
+                results << response << '\n';
+            }
+            
+            // Flush only when no more input is buffered, so piped files run at full speed
+            // while interactive callers still see each result as soon as it is ready
+            if (in.rdbuf()->in_avail() <= 0) results.flush();
+        }
+        
+        results.flush();
+        cout.rdbuf(console);
+        
+        return session.errors;
+    }
+};
+
+// ============= NETWORK SERVER =============
+#ifdef __linux__
+// Serves the command protocol over TCP: one command per line in, one response line
+// out, one session (login state) per connection. A single reactor thread waits on
+// epoll and hands ready connections to a pool of workers. Connections are armed
+// with EPOLLONESHOT, so only one worker handles a given connection at a time. That
+// worker reads, runs every complete line in order, writes the responses and re-arms
+// the connection. No per-connection locking is needed, and a slow client only ties
+// up a worker for as long as its own commands take.
+class BookingServer {
+private:
+    struct Connection {
+        int fd;
+        string input;
+        string output;
+        bool closing; // Close once output has drained ("quit" or a protocol error)
+        string httpPath; // Set while reading the headers of an HTTP request
+        CommandInterpreter::Session session;
+        
+        Connection(int fd) : fd(fd), closing(false) {}
+    };
+    
+    static const size_t maxLineLength = 64 * 1024;
+    static const size_t maxPendingOutput = 1024 * 1024; // Stop reading from clients that do not read replies
+    static const int maxEventsPerWait = 256;
+    
+    CommandInterpreter* interpreter;
+    string host;
+    int port;
+    int numWorkers;
+    
+    int listenFd;
+    int epollFd;
+    atomic<bool> running;
+    
+    unordered_set<Connection*> connections; // Everything accepted and not yet closed
+    mutex connectionsMutex;
+    
+    vector<thread> workers;
+    deque<Connection*> ready;
+    mutex readyMutex;
+    condition_variable readyCondition;
+    
+    static bool setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+    
+    void arm(Connection* con, int op) {
+        epoll_event event;
+        event.events = EPOLLONESHOT | EPOLLRDHUP;
+        if (!con->closing && con->output.size() < maxPendingOutput) event.events |= EPOLLIN;
+        if (!con->output.empty()) event.events |= EPOLLOUT;
+        event.data.ptr = con;
+        epoll_ctl(epollFd, op, con->fd, &event);
+    }
+    
+    void close(Connection* con) {
+        {
+            lock_guard<mutex> lock(connectionsMutex);
+            connections.erase(con);
+        }
+        ::close(con->fd); // Also removes it from the epoll set
+        delete con;
+    }
+    
+    void acceptConnections() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                // EAGAIN: backlog drained. Anything else (e.g. out of descriptors) waits for the next wakeup.
+                return;
+            }
+            
+            int noDelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            
+            Connection* con = new Connection(fd);
+            {
+                lock_guard<mutex> lock(connectionsMutex);
+                connections.insert(con);
+            }
+            arm(con, EPOLL_CTL_ADD);
+        }
+    }
+    
+    // False when the connection is finished and should be closed
+    bool flushOutput(Connection* con) {
+        while (!con->output.empty()) {
+            ssize_t sent = send(con->fd, con->output.data(), con->output.size(), MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+                if (errno == EINTR) continue;
+                return false;
+            }
+            con->output.erase(0, sent);
+        }
+        return !con->closing;
     }
     
-    void registerUser() {
-        Utility::clearScreen();
-        cout << "\n===== USER REGISTRATION =====\n";
+    // Read what is available and run every complete line; false when the peer is gone
+    bool readAndExecute(Connection* con) {
+        char buffer[16 * 1024];
+        bool peerClosed = false;
         
-        string username = Utility::getInput("Enter username: ");
-        string password = Utility::getInput("Enter password: ");
-        string fullName = Utility::getInput("Enter full name: ");
-        string email = Utility::getInput("Enter email: ");
-        string phone = Utility::getInput("Enter phone number: ");
+        while (con->output.size() < maxPendingOutput) {
+            ssize_t received = recv(con->fd, buffer, sizeof(buffer), 0);
+            if (received > 0) {
+                con->input.append(buffer, received);
+                continue;
+            }
+            if (received == 0) {
+                peerClosed = true;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            break;
+        }
         
-        User newUser(0, username, password, fullName, email, phone, Utility::getCurrentDate());
+        size_t start = 0, end;
+        string response;
         
-        if (userManager->registerUser(newUser)) {
-            cout << "Registration successful! You can now login.\n";
-        } else {
-            cout << "Registration failed. Username or email might already exist.\n";
+        while (!con->closing && (end = con->input.find('\n', start)) != string::npos) {
+            string line = con->input.substr(start, end - start);
+            start = end + 1;
+            if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+            
+            if (!con->httpPath.empty()) {
+                // Headers are ignored; the blank line ends the request
+                if (line.empty()) {
+                    respondHttp(con);
+                }
+            } else if (con->session.lineNumber == 0 && line.compare(0, 4, "GET ") == 0) {
+                // A scraper on the command port: "GET /metrics HTTP/1.1"
+                size_t pathEnd = line.find(' ', 4);
+                con->httpPath = line.substr(4, pathEnd == string::npos ? string::npos : pathEnd - 4);
+            } else if (line == "quit") {
+                con->output += "ok quit\n";
+                con->closing = true;
+            } else if (interpreter->execute(con->session, line, response)) {
+                con->output += response;
+                con->output += '\n';
+            }
         }
+        con->input.erase(0, start);
         
-        Utility::pressEnterToContinue();
+        if (con->input.size() > maxLineLength) {
+            con->output += "error " + to_string(con->session.lineNumber + 1) + ": line too long\n";
+            con->closing = true;
+        }
+        
+        // Commands already read still get their replies if the client half-closed
+        if (peerClosed) con->closing = true;
+        return true;
     }
     
-    bool loginUser() {
-        Utility::clearScreen();
-        cout << "\n===== USER LOGIN =====\n";
-        
-        string username = Utility::getInput("Enter username: ");
-        string password = Utility::getInput("Enter password: ");
+    // One-shot HTTP reply, so Prometheus can scrape the command port directly
+    static void respondHttp(Connection* con) {
+        string status = "200 OK", body;
         
-        currentUser = userManager->loginUser(username, password);
-        
-        if (currentUser) {
-            cout << "Login successful! Welcome, " << currentUser->getName() << "!\n";
-            Utility::pressEnterToContinue();
-            return true;
+        if (con->httpPath == "/metrics") {
+            body = Metrics::renderPrometheus();
         } else {
-            cout << "Login failed. Invalid username or password.\n";
-            Utility::pressEnterToContinue();
-            return false;
+            status = "404 Not Found";
+            body = "Only /metrics is served over HTTP\n";
         }
+        
+        con->output += "HTTP/1.1 " + status + "\r\n"
+                       "Content-Type: text/plain; version=0.0.4\r\n"
+                       "Content-Length: " + to_string(body.size()) + "\r\n"
+                       "Connection: close\r\n\r\n" + body;
+        con->closing = true;
     }
     
-    void searchTrains() {
-        Utility::clearScreen();
-        cout << "\n===== SEARCH TRAINS =====\n";
+    void handle(Connection* con) {
+        if (!readAndExecute(con) || !flushOutput(con)) {
+            close(con);
+            return;
+        }
+        arm(con, EPOLL_CTL_MOD);
+    }
+    
+    void workerLoop() {
+        while (true) {
+            Connection* con;
+            {
+                unique_lock<mutex> lock(readyMutex);
+                readyCondition.wait(lock, [this]() { return !ready.empty() || !running.load(); });
+                if (ready.empty()) return;
+                
+                con = ready.front();
+                ready.pop_front();
+            }
+            handle(con);
+        }
+    }
+
+public:
+    BookingServer(CommandInterpreter* interpreter, const string& host, int port, int numWorkers)
+        : interpreter(interpreter), host(host), port(port), numWorkers(max(numWorkers, 1)),
+          listenFd(-1), epollFd(-1), running(false) {}
+    
+    ~BookingServer() {
+        for (Connection* con : connections) {
+            ::close(con->fd);
+            delete con;
+        }
+        if (listenFd >= 0) ::close(listenFd);
+        if (epollFd >= 0) ::close(epollFd);
+    }
+    
+    // Bind and listen; false (with a message) if the address is unusable
+    bool start() {
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (listenFd < 0 || epollFd < 0) {
+            cerr << "Server error: " << strerror(errno) << endl;
+            return false;
+        }
         
-        string source = Utility::getInput("Enter source station (or part of name): ");
-        string destination = Utility::getInput("Enter destination station (or part of name): ");
+        int reuse = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
         
-        vector<Train> trains = trainManager->searchTrains(source, destination);
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)port);
         
-        if (trains.empty()) {
-            cout << "No trains found matching your criteria.\n";
-        } else {
-            cout << "\nFound " << trains.size() << " train(s):\n";
-            Train::displayHeader();
-            
-            for (const auto& train : trains) {
-                train.displayInfo();
-            }
+        if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+            cerr << "Server error: invalid address " << host << endl;
+            return false;
+        }
+        if (bind(listenFd, (sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+            cerr << "Server error: cannot listen on " << host << ":" << port << ": " << strerror(errno) << endl;
+            return false;
         }
         
-        Utility::pressEnterToContinue();
+        // Report the real port when an ephemeral one (0) was requested
+        socklen_t length = sizeof(address);
+        getsockname(listenFd, (sockaddr*)&address, &length);
+        port = ntohs(address.sin_port);
+        
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr; // The listening socket
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+        
+        running = true;
+        for (int i = 0; i < numWorkers; i++) {
+            workers.push_back(thread(&BookingServer::workerLoop, this));
+        }
+        return true;
     }
     
-    void viewAllTrains() {
-        Utility::clearScreen();
-        cout << "\n===== ALL AVAILABLE TRAINS =====\n";
-        
-        vector<Train> trains = trainManager->getAllTrains();
+    // Reactor loop; returns after stop() once the workers have finished
+    void run() {
+        epoll_event events[maxEventsPerWait];
         
-        if (trains.empty()) {
-            cout << "No trains available in the system.\n";
-        } else {
-            cout << "\nTotal " << trains.size() << " train(s):\n";
-            Train::displayHeader();
+        while (running.load()) {
+            // Bounded wait so stop() is noticed without a wakeup descriptor
+            int count = epoll_wait(epollFd, events, maxEventsPerWait, 200);
             
-            for (const auto& train : trains) {
-                train.displayInfo();
+            for (int i = 0; i < count; i++) {
+                if (!events[i].data.ptr) {
+                    acceptConnections();
+                    continue;
+                }
+                
+                {
+                    lock_guard<mutex> lock(readyMutex);
+                    ready.push_back((Connection*)events[i].data.ptr);
+                }
+                readyCondition.notify_one();
             }
         }
         
-        Utility::pressEnterToContinue();
+        readyCondition.notify_all();
+        for (auto& worker : workers) worker.join();
+        workers.clear();
     }
     
-    void bookTicket() {
-        Utility::clearScreen();
-        cout << "\n===== BOOK TRAIN TICKET =====\n";
-        
-        // First, show all available trains
-        vector<Train> trains = trainManager->getAllTrains();
+    // Safe to call from any thread
+    void stop() {
+        running = false;
+    }
+    
+    // Getters
+    int getPort() const { return port; }
+    size_t getOpenConnections() {
+        lock_guard<mutex> lock(connectionsMutex);
+        return connections.size();
+    }
+};
+#endif
+
+// ============= STRESS TEST =============
+// Hammers one (train, date) from many threads through the same reserve -> seat
+// allocation -> release sequence that BookingManager uses, each request between two
+// random stops, then checks that no seat was sold twice on any segment and the
+// inventory never went past capacity.
+class ReservationStressTest {
+private:
+    static const int stopCount = 6;
+    
+    struct Held {
+        int numSeats;
+        int fromStop;
+        int toStop;
+        vector<string> seats;
+    };
+    
+    struct WorkerResult {
+        unsigned long long confirmed;
+        unsigned long long rejected;
+        unsigned long long cancelled;
+        vector<Held> held;
         
-        if (trains.empty()) {
-            cout << "No trains available for booking.\n";
-            Utility::pressEnterToContinue();
-            return;
-        }
+        WorkerResult() : confirmed(0), rejected(0), cancelled(0) {}
+    };
+
+public:
+    static bool run(int numThreads, int requestsPerThread, int totalSeats) {
+        const int trainId = 1;
+        const string journeyDate = "2025-01-01";
         
-        cout << "\nAvailable Trains:\n";
-        Train::displayHeader();
+        SeatInventory inventory;
+        SeatAllocator allocator;
+        inventory.load(trainId, journeyDate, vector<int>(stopCount - 1, totalSeats));
+        allocator.load(trainId, journeyDate, SeatMap(totalSeats, stopCount - 1));
         
-        for (const auto& train : trains) {
-            train.displayInfo();
-        }
+        cout << "Reservation stress test: " << numThreads << " threads x " << requestsPerThread
+             << " requests on one train with " << totalSeats << " seats and " << stopCount << " stops\n";
         
-        int trainId = Utility::getIntInput("\nEnter Train ID to book: ");
+        vector<WorkerResult> results(numThreads);
+        vector<thread> workers;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
         
-        // Check if train exists
-        Train* selectedTrain = trainManager->getTrainById(trainId);
-        if (!selectedTrain) {
-            cout << "Invalid Train ID. Please try again.\n";
-            Utility::pressEnterToContinue();
-            return;
+        for (int t = 0; t < numThreads; t++) {
+            workers.push_back(thread([&, t]() {
+                mt19937 rng(t + 1);
+                uniform_int_distribution<int> groupSize(1, 6);
+                uniform_int_distribution<int> percent(0, 99);
+                uniform_int_distribution<int> stop(0, stopCount - 1);
+                WorkerResult& result = results[t];
+                
+                for (int i = 0; i < requestsPerThread; i++) {
+                    // Cancel now and then so freed seats are contended for again
+                    if (!result.held.empty() && percent(rng) < 30) {
+                        Held booking = result.held.back();
+                        result.held.pop_back();
+                        
+                        SeatAllocator::Entry* seatEntry = allocator.find(trainId, journeyDate);
+                        {
+                            lock_guard<mutex> lock(seatEntry->mtx);
+                            seatEntry->seats.release(booking.seats, booking.fromStop, booking.toStop);
+                        }
+                        inventory.release(inventory.find(trainId, journeyDate), booking.numSeats,
+                                          booking.fromStop, booking.toStop, totalSeats);
+                        result.cancelled++;
+                        continue;
+                    }
+                    
+                    int numSeats = groupSize(rng);
+                    int fromStop = stop(rng);
+                    int toStop = stop(rng);
+                    if (fromStop == toStop) toStop = stopCount - 1;
+                    if (fromStop == toStop) fromStop = 0;
+                    if (fromStop > toStop) swap(fromStop, toStop);
+                    
+                    SeatInventory::Entry* entry = inventory.find(trainId, journeyDate);
+                    
+                    if (!inventory.tryReserve(entry, numSeats, fromStop, toStop)) {
+                        result.rejected++;
+                        continue;
+                    }
+                    
+                    SeatAllocator::Entry* seatEntry = allocator.find(trainId, journeyDate);
+                    vector<string> seats;
+                    {
+                        lock_guard<mutex> lock(seatEntry->mtx);
+                        seats = seatEntry->seats.allocate(numSeats, fromStop, toStop);
+                    }
+                    
+                    if ((int)seats.size() != numSeats) {
+                        inventory.release(entry, numSeats, fromStop, toStop, totalSeats);
+                        result.rejected++;
+                        continue;
+                    }
+                    
+                    result.held.push_back({numSeats, fromStop, toStop, seats});
+                    result.confirmed++;
+                }
+            }));
         }
         
-        string journeyDate = Utility::getInput("Enter journey date (YYYY-MM-DD): ");
+        for (auto& worker : workers) worker.join();
         
-        // Check available seats
-        int availableSeats = trainManager->getAvailableSeats(trainId, journeyDate);
-        cout << "Available seats: " << availableSeats << endl;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
         
-        if (availableSeats <= 0) {
-            cout << "Sorry, no seats available for this train on the selected date.\n";
-            Utility::pressEnterToContinue();
-            delete selectedTrain;
-            return;
+        unsigned long long confirmed = 0, rejected = 0, cancelled = 0;
+        vector<int> seatsHeld(stopCount - 1, 0);
+        vector<vector<string>> seatsBySegment(stopCount - 1);
+        
+        for (const auto& result : results) {
+            confirmed += result.confirmed;
+            rejected += result.rejected;
+            cancelled += result.cancelled;
+            for (const auto& booking : result.held) {
+                for (int segment = booking.fromStop; segment < booking.toStop; segment++) {
+                    seatsHeld[segment] += booking.numSeats;
+                    seatsBySegment[segment].insert(seatsBySegment[segment].end(), booking.seats.begin(), booking.seats.end());
+                }
+            }
         }
         
-        int numPassengers = Utility::getIntInput("Enter number of passengers: ");
+        // Every segment on its own must look like a correctly sold train
+        SeatInventory::Entry* entry = inventory.find(trainId, journeyDate);
+        size_t duplicates = 0;
+        int busiest = 0;
+        bool consistent = true;
         
-        if (numPassengers <= 0 || numPassengers > availableSeats) {
-            cout << "Invalid number of passengers. Please try again.\n";
-            Utility::pressEnterToContinue();
-            delete selectedTrain;
-            return;
+        for (int segment = 0; segment < stopCount - 1; segment++) {
+            vector<string>& seats = seatsBySegment[segment];
+            sort(seats.begin(), seats.end());
+            duplicates += seats.size() - (unique(seats.begin(), seats.end()) - seats.begin());
+            
+            int available = inventory.available(entry, segment, segment + 1);
+            consistent = consistent && seatsHeld[segment] <= totalSeats && seatsHeld[segment] + available == totalSeats;
+            busiest = max(busiest, seatsHeld[segment]);
         }
         
-        // Create booking
-        Booking newBooking(
-            0, currentUser->getUserId(), trainId, Utility::getCurrentDate(), journeyDate,
-            numPassengers, 0.0, "Confirmed", "Pending"
-        );
+        bool passed = duplicates == 0 && consistent;
         
-        // Add passenger details
-        cout << "\nEnter passenger details:\n";
+        cout << "Confirmed: " << confirmed << "  Rejected: " << rejected << "  Cancelled: " << cancelled << endl;
+        cout << "Seats held on the busiest segment: " << busiest << " / " << totalSeats
+             << ", inventory matches on every segment: " << (consistent ? "yes" : "no") << endl;
+        cout << "Duplicate seats: " << duplicates << endl;
+        cout << "Throughput: " << fixed << setprecision(0)
+             << (numThreads * (double)requestsPerThread) / seconds << " requests/s" << endl;
+        cout << "RESULT: " << (passed ? "PASS" : "FAIL") << endl;
         
-        for (int i = 0; i < numPassengers; i++) {
-            cout << "\nPassenger " << (i + 1) << ":\n";
-            string name = Utility::getInput("Name: ");
-            int age = Utility::getIntInput("Age: ");
-            string gender = Utility::getInput("Gender (Male/Female/Other): ");
-            
-            // Assign seat number (simple sequential assignment)
-            string seatNumber = "A" + to_string(i + 1);
-            
-            Passenger passenger(0, name, age, gender, seatNumber);
-            newBooking.addPassenger(passenger);
+        return passed;
+    }
+};
+
+// ============= BENCHMARK =============
+// Log-linear latency histogram in the style of HdrHistogram: values below 256 are
+// exact, larger ones land in one of 128 sub-buckets per power of two, so any
+// recorded value is reported to within 1%. Recording is a couple of shifts and
+// an increment; one histogram per thread, merged when the run is over.
+class LatencyHistogram {
+private:
+    static const int subBucketBits = 8;
+    static const uint64_t subBucketCount = uint64_t(1) << subBucketBits;
+    static const uint64_t subBucketHalf = subBucketCount / 2;
+    
+    vector<uint64_t> counts;
+    uint64_t totalCount;
+    uint64_t minValue;
+    uint64_t maxValue;
+    double sum;
+    
+    static int highestBit(uint64_t value) {
+        #ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse64(&index, value);
+            return (int)index;
+        #else
+            return 63 - __builtin_clzll(value);
+        #endif
+    }
+    
+    static size_t indexOf(uint64_t value) {
+        if (value < subBucketCount) return (size_t)value;
+        
+        int shift = highestBit(value) - (subBucketBits - 1);
+        return (size_t)(subBucketCount + (shift - 1) * subBucketHalf + ((value >> shift) - subBucketHalf));
+    }
+    
+    // Largest value that maps to the bucket
+    static uint64_t highestValueAt(size_t index) {
+        if (index < subBucketCount) return index;
+        
+        uint64_t offset = index - subBucketCount;
+        int shift = (int)(offset / subBucketHalf) + 1;
+        uint64_t subBucket = offset % subBucketHalf + subBucketHalf;
+        return ((subBucket + 1) << shift) - 1;
+    }
+
+public:
+    LatencyHistogram()
+        : counts(indexOf(UINT64_MAX) + 1, 0), totalCount(0), minValue(UINT64_MAX), maxValue(0), sum(0) {}
+    
+    void record(uint64_t value) {
+        counts[indexOf(value)]++;
+        totalCount++;
+        minValue = min(minValue, value);
+        maxValue = max(maxValue, value);
+        sum += value;
+    }
+    
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts.size(); i++) counts[i] += other.counts[i];
+        totalCount += other.totalCount;
+        minValue = min(minValue, other.minValue);
+        maxValue = max(maxValue, other.maxValue);
+        sum += other.sum;
+    }
+    
+    // Smallest recorded value such that the given percentage of values are at or below it
+    uint64_t percentile(double percent) const {
+        if (totalCount == 0) return 0;
+        
+        uint64_t rank = (uint64_t)ceil(percent / 100.0 * totalCount);
+        rank = max(rank, (uint64_t)1);
+        
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= rank) return min(highestValueAt(i), maxValue);
         }
+        return maxValue;
+    }
+    
+    // Getters
+    uint64_t getCount() const { return totalCount; }
+    uint64_t getMin() const { return totalCount ? minValue : 0; }
+    uint64_t getMax() const { return maxValue; }
+    double getMean() const { return totalCount ? sum / totalCount : 0; }
+};
+
+// Drives UserManager, TrainManager and BookingManager from many threads with a
+// configurable operation mix and reports per-operation throughput and latency.
+// Runs against InMemoryBackend by default so it measures the booking logic
+// itself; backend=mysql uses the configured database (and leaves its bookings there).
+class BookingBenchmark {
+public:
+    struct Config {
+        int threads;
+        int operationsPerThread;
+        int searchWeight;
+        int availabilityWeight;
+        int bookWeight;
+        int cancelWeight;
+        int payWeight;
+        int numTrains;
+        int seatsPerTrain;
+        int numDates;
+        double skew; // Zipf exponent for train popularity; 0 is uniform
+        int minGroupSize;
+        int maxGroupSize;
+        unsigned int seed;
+        string backend;
+        string format;
+        string metricsPath; // Prometheus dump of the run, if set
+        int gatewayLatencyMs;      // Simulated payment gateway
+        double gatewayFailureRate;
+        int paymentWorkers;
         
-        // Save booking
-        if (bookingManager->createBooking(newBooking)) {
-            cout << "\nBooking created successfully! Booking ID: " << newBooking.getBookingId() << endl;
-            cout << "Total fare: $" << fixed << setprecision(2) << newBooking.getTotalFare() << endl;
-            
-            // Process payment
-            cout << "\nProceed to payment? (y/n): ";
-            string choice;
-            getline(cin, choice);
+        Config() : threads(8), operationsPerThread(20000), searchWeight(40), availabilityWeight(30),
+                   bookWeight(20), cancelWeight(10), payWeight(0), numTrains(50), seatsPerTrain(500), numDates(7),
+                   skew(1.0), minGroupSize(1), maxGroupSize(6), seed(1), backend("memory"), format("text"),
+                   gatewayLatencyMs(50), gatewayFailureRate(0.05), paymentWorkers(4) {}
+    };
+    
+    // Parse key=value arguments; false (with a message) on anything unrecognised
+    static bool parseConfig(int argc, char* argv[], Config& config) {
+        for (int i = 0; i < argc; i++) {
+            string arg = argv[i];
+            size_t eq = arg.find('=');
+            string key = arg.substr(0, eq);
+            string value = eq == string::npos ? "" : arg.substr(eq + 1);
             
-            if (choice == "y" || choice == "Y") {
-                paymentSystem->displayPaymentOptions();
-                int paymentOption = Utility::getIntInput("Select payment method: ");
-                
-                string paymentMethod;
-                switch (paymentOption) {
-                    case 1: paymentMethod = "Credit Card"; break;
-                    case 2: paymentMethod = "Debit Card"; break;
-                    case 3: paymentMethod = "Net Banking"; break;
-                    case 4: paymentMethod = "UPI Payment"; break;
-                    default: 
-                        cout << "Payment cancelled.\n";
-                        Utility::pressEnterToContinue();
-                        delete selectedTrain;
-                        return;
+            if (key == "threads") config.threads = atoi(value.c_str());
+            else if (key == "ops") config.operationsPerThread = atoi(value.c_str());
+            else if (key == "search") config.searchWeight = atoi(value.c_str());
+            else if (key == "availability") config.availabilityWeight = atoi(value.c_str());
+            else if (key == "book") config.bookWeight = atoi(value.c_str());
+            else if (key == "cancel") config.cancelWeight = atoi(value.c_str());
+            else if (key == "pay") config.payWeight = atoi(value.c_str());
+            else if (key == "gateway_latency") config.gatewayLatencyMs = atoi(value.c_str());
+            else if (key == "gateway_failures") config.gatewayFailureRate = atof(value.c_str());
+            else if (key == "payment_workers") config.paymentWorkers = atoi(value.c_str());
+            else if (key == "trains") config.numTrains = atoi(value.c_str());
+            else if (key == "seats") config.seatsPerTrain = atoi(value.c_str());
+            else if (key == "dates") config.numDates = atoi(value.c_str());
+            else if (key == "skew") config.skew = atof(value.c_str());
+            else if (key == "seed") config.seed = (unsigned int)strtoul(value.c_str(), nullptr, 10);
+            else if (key == "backend") config.backend = value;
+            else if (key == "format") config.format = value;
+            else if (key == "metrics") config.metricsPath = value;
+            else if (key == "group") {
+                if (sscanf(value.c_str(), "%d-%d", &config.minGroupSize, &config.maxGroupSize) == 1) {
+                    config.maxGroupSize = config.minGroupSize;
                 }
-                
-                paymentSystem->processPayment(newBooking.getBookingId(), paymentMethod);
+            } else {
+                cerr << "Unknown benchmark option: " << arg << endl;
+                return false;
             }
-        } else {
-            cout << "Booking failed. Please try again.\n";
         }
         
-        delete selectedTrain;
-        Utility::pressEnterToContinue();
+        if (config.threads < 1 || config.operationsPerThread < 1 || config.numTrains < 1 ||
+            config.numDates < 1 || config.minGroupSize < 1 || config.maxGroupSize < config.minGroupSize ||
+            config.searchWeight < 0 || config.availabilityWeight < 0 || config.bookWeight < 0 ||
+            config.cancelWeight < 0 || config.payWeight < 0 || config.gatewayLatencyMs < 0 ||
+            config.gatewayFailureRate < 0 || config.gatewayFailureRate > 1 || config.paymentWorkers < 1 ||
+            config.searchWeight + config.availabilityWeight + config.bookWeight + config.cancelWeight +
+                config.payWeight == 0 ||
+            (config.backend != "memory" && config.backend != "mysql") ||
+            (config.format != "text" && config.format != "json" && config.format != "csv")) {
+            cerr << "Invalid benchmark configuration" << endl;
+            return false;
+        }
+        return true;
     }
     
-    void viewMyBookings() {
-        Utility::clearScreen();
-        cout << "\n===== MY BOOKINGS =====\n";
-        
-        vector<Booking> bookings = bookingManager->getUserBookings(currentUser->getUserId());
+    static bool run(const Config& config) {
+        // Managers report sold-out trains and SQL errors on cout; keep that out of the report
+        NullBuffer discard;
+        streambuf* console = cout.rdbuf(&discard);
         
-        if (bookings.empty()) {
-            cout << "You don't have any bookings yet.\n";
+        StorageBackend* backend;
+        if (config.backend == "mysql") {
+            try {
+                backend = new MySqlBackend();
+            } catch (...) {
+                cout.rdbuf(console);
+                throw;
+            }
         } else {
-            cout << "You have " << bookings.size() << " booking(s):\n\n";
-            
-            for (const auto& booking : bookings) {
-                Train* train = trainManager->getTrainById(booking.getTrainId());
-                if (train) {
-                    booking.displayInfo(*train);
-                    delete train;
-                }
-                cout << "\n" << string(40, '-') << "\n";
+            InMemoryBackend* memory = new InMemoryBackend();
+            for (int i = 0; i < config.numTrains; i++) {
+                memory->addTrain(Train(0, "Bench Express " + to_string(i + 1), "BEN" + to_string(i + 1),
+                                       stationName(i), stationName(i + 1 + i % 3),
+                                       "06:00:00", "12:00:00", config.seatsPerTrain));
             }
+            backend = memory;
         }
         
-        Utility::pressEnterToContinue();
-    }
-    
-    void cancelBooking() {
-        Utility::clearScreen();
-        cout << "\n===== CANCEL BOOKING =====\n";
+        UserManager userManager(backend->users());
+        TrainManager trainManager(backend->trains(), backend->queryExecutor());
+        BookingManager bookingManager(backend->bookings(), backend->passengers(), &trainManager);
+        SimulatedPaymentGateway* gateway = new SimulatedPaymentGateway(
+            chrono::milliseconds(config.gatewayLatencyMs), config.gatewayFailureRate);
+        unique_ptr<PaymentSystem> paymentSystem(new PaymentSystem(&bookingManager, gateway, config.paymentWorkers));
         
-        vector<Booking> bookings = bookingManager->getUserBookings(currentUser->getUserId());
+        vector<Train> trains = trainManager.getAllTrains();
+        vector<int> userIds;
+        string runTag = to_string(time(nullptr));
+        
+        for (int t = 0; t < config.threads; t++) {
+            string name = "bench_" + runTag + "_" + to_string(t);
+            User user(0, name, "bench", "Benchmark User", name + "@bench.local", "0000000000", "");
+            if (userManager.registerUser(user)) userIds.push_back(user.getUserId());
+        }
+        
+        if (trains.empty() || (int)userIds.size() != config.threads) {
+            cout.rdbuf(console);
+            cerr << "Benchmark setup failed: need at least one train and a user per thread" << endl;
+            delete backend;
+            return false;
+        }
+        
+        // Journey dates spread over the coming days
+        vector<string> dates;
+        for (int d = 0; d < config.numDates; d++) {
+            time_t day = time(nullptr) + (time_t)(d + 1) * 24 * 60 * 60;
+            char buffer[11];
+            tm local = Utility::localTime(day);
+            strftime(buffer, sizeof(buffer), "%Y-%m-%d", &local);
+            dates.push_back(buffer);
+        }
         
-        if (bookings.empty()) {
-            cout << "You don't have any bookings to cancel.\n";
-            Utility::pressEnterToContinue();
-            return;
+        vector<double> trainWeights;
+        for (size_t i = 0; i < trains.size(); i++) {
+            trainWeights.push_back(pow((double)(i + 1), -config.skew));
         }
         
-        cout << "Your active bookings:\n\n";
-        cout << left << setw(10) << "BookingID" 
-             << setw(15) << "Journey Date" 
-             << setw(10) << "Train" 
-             << setw(8) << "Status" << endl;
-        cout << string(43, '-') << endl;
+        vector<WorkerResult> results(config.threads);
+        vector<thread> workers;
+        atomic<int> ready(0);
+        atomic<bool> go(false);
+        chrono::steady_clock::time_point start;
         
-        for (const auto& booking : bookings) {
-            if (booking.getBookingStatus() != "Cancelled") {
-                Train* train = trainManager->getTrainById(booking.getTrainId());
+        for (int t = 0; t < config.threads; t++) {
+            workers.push_back(thread([&, t]() {
+                mt19937 rng(config.seed * 7919 + t);
+                discrete_distribution<int> operation({
+                    (double)config.searchWeight, (double)config.availabilityWeight,
+                    (double)config.bookWeight, (double)config.cancelWeight, (double)config.payWeight });
+                discrete_distribution<int> pickTrain(trainWeights.begin(), trainWeights.end());
+                uniform_int_distribution<int> pickDate(0, config.numDates - 1);
+                uniform_int_distribution<int> groupSize(config.minGroupSize, config.maxGroupSize);
+                WorkerResult& result = results[t];
+                vector<pair<int, double>> held; // Booking ID and fare
                 
-                cout << left << setw(10) << booking.getBookingId()
-                     << setw(15) << booking.getJourneyDate()
-                     << setw(10) << (train ? train->getTrainNumber() : "Unknown")
-                     << setw(8) << booking.getBookingStatus() << endl;
+                ready++;
+                while (!go.load()) this_thread::yield();
                 
-                delete train;
-            }
+                for (int i = 0; i < config.operationsPerThread; i++) {
+                    int op = operation(rng);
+                    const Train& train = trains[pickTrain(rng)];
+                    const string& date = dates[pickDate(rng)];
+                    
+                    // Nothing to cancel or pay for yet: book instead so the mix stays meaningful
+                    if ((op == Cancel || op == Pay) && held.empty()) op = Book;
+                    
+                    bool ok = true;
+                    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+                    
+                    switch (op) {
+                        case Search:
+                            trainManager.searchTrains(train.getSource(), train.getDestination());
+                            break;
+                        case Availability:
+                            ok = trainManager.getAvailableSeats(train.getTrainId(), date) >= 0;
+                            break;
+                        case Book: {
+                            int numPassengers = groupSize(rng);
+                            Booking booking(0, userIds[t], train.getTrainId(), Utility::getCurrentDate(), date,
+                                            numPassengers, 0.0, "Confirmed", "Pending");
+                            for (int p = 0; p < numPassengers; p++) {
+                                booking.addPassenger(Passenger(0, "Passenger " + to_string(p + 1), 30, "Other"));
+                            }
+                            ok = bookingManager.createBooking(booking);
+                            if (ok) held.push_back(make_pair(booking.getBookingId(), booking.getTotalFare()));
+                            break;
+                        }
+                        case Cancel: {
+                            uniform_int_distribution<size_t> pickHeld(0, held.size() - 1);
+                            size_t index = pickHeld(rng);
+                            ok = bookingManager.cancelBooking(held[index].first);
+                            held[index] = held.back();
+                            held.pop_back();
+                            break;
+                        }
+                        case Pay: {
+                            // Paying twice for a booking hands back the first payment
+                            uniform_int_distribution<size_t> pickHeld(0, held.size() - 1);
+                            const pair<int, double>& booking = held[pickHeld(rng)];
+                            PaymentSystem::Payment payment;
+                            ok = paymentSystem->submit(PaymentSystem::keyFor(booking.first), booking.first,
+                                                       booking.second, "Credit Card", payment);
+                            break;
+                        }
+                    }
+                    
+                    uint64_t elapsed = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+                        chrono::steady_clock::now() - begin).count();
+                    result.latency[op].record(elapsed);
+                    if (!ok) result.failed[op]++;
+                }
+            }));
         }
         
-        int bookingId = Utility::getIntInput("\nEnter Booking ID to cancel (0 to go back): ");
+        while (ready.load() < config.threads) this_thread::yield();
+        start = chrono::steady_clock::now();
+        go = true;
         
-        if (bookingId == 0) return;
+        for (auto& worker : workers) worker.join();
         
-        bool found = false;
-        for (const auto& booking : bookings) {
-            if (booking.getBookingId() == bookingId && booking.getBookingStatus() != "Cancelled") {
-                found = true;
-                break;
-            }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        
+        // Payments finish in the background; wait for them only after the clock has stopped
+        // Unknown outcomes settle once a lookup succeeds, which a gateway that always errors never allows
+        auto drainDeadline = chrono::steady_clock::now() + chrono::seconds(30);
+        while (paymentSystem->countInState(PaymentSystem::Queued) + paymentSystem->countInState(PaymentSystem::Processing) +
+               paymentSystem->countInState(PaymentSystem::Charged) + paymentSystem->countInState(PaymentSystem::Unknown) > 0 &&
+               chrono::steady_clock::now() < drainDeadline) {
+            this_thread::sleep_for(chrono::milliseconds(10));
         }
+        double drainSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count() - seconds;
+        size_t paid = paymentSystem->countInState(PaymentSystem::Paid);
+        size_t failed = paymentSystem->countInState(PaymentSystem::Failed);
+        size_t unknownOutcomes = paymentSystem->countInState(PaymentSystem::Unknown);
+        size_t charges = gateway->chargeCount();
+        uint64_t gatewayCalls = gateway->callCount();
+        paymentSystem.reset();
+        cout.rdbuf(console);
         
-        if (!found) {
-            cout << "Invalid Booking ID or booking already cancelled.\n";
-            Utility::pressEnterToContinue();
-            return;
+        WorkerResult total;
+        for (const auto& result : results) {
+            for (int op = 0; op < OperationCount; op++) {
+                total.latency[op].merge(result.latency[op]);
+                total.failed[op] += result.failed[op];
+            }
         }
         
-        cout << "Are you sure you want to cancel booking #" << bookingId << "? (y/n): ";
-        string choice;
-        getline(cin, choice);
+        report(config, trains.size(), seconds, total);
         
-        if (choice == "y" || choice == "Y") {
-            if (bookingManager->cancelBooking(bookingId)) {
-                cout << "Booking cancelled successfully.\n";
-                cout << "A refund will be processed according to the cancellation policy.\n";
-            } else {
-                cout << "Failed to cancel booking. Please try again.\n";
-            }
-        } else {
-            cout << "Cancellation aborted.\n";
+        // Every successful charge must belong to exactly one Paid payment
+        if (config.payWeight > 0 && config.format == "text") {
+            cout << "\nPayments: " << paid << " paid, " << failed << " failed, " << unknownOutcomes << " unknown, "
+                 << gatewayCalls << " gateway calls, "
+                 << charges << " charges (" << (charges > paid ? charges - paid : 0) << " without a paid booking), "
+                 << fixed << setprecision(2) << drainSeconds << " s to finish after the run" << endl;
+        }
+
+        if (!config.metricsPath.empty()) {
+            ofstream metricsFile(config.metricsPath.c_str());
+            metricsFile << Metrics::renderPrometheus();
+            if (!metricsFile) cerr << "Cannot write " << config.metricsPath << endl;
         }
         
-        Utility::pressEnterToContinue();
+        delete backend;
+        return true;
     }
+
+private:
+    enum Operation { Search, Availability, Book, Cancel, Pay, OperationCount };
     
-    void updateProfile() {
-        Utility::clearScreen();
-        cout << "\n===== UPDATE PROFILE =====\n";
-        
-        currentUser->displayInfo();
-        cout << "\nEnter new details (leave blank to keep current value):\n";
-        
-        string fullName = Utility::getInput("Full Name: ");
-        string email = Utility::getInput("Email: ");
-        string phone = Utility::getInput("Phone: ");
-        
-        if (!fullName.empty()) currentUser->setName(fullName);
-        if (!email.empty()) currentUser->setEmail(email);
-        if (!phone.empty()) currentUser->setPhone(phone);
+    struct WorkerResult {
+        LatencyHistogram latency[OperationCount];
+        uint64_t failed[OperationCount];
         
-        if (userManager->updateUserProfile(*currentUser)) {
-            cout << "Profile updated successfully!\n";
-        } else {
-            cout << "Failed to update profile. Please try again.\n";
+        WorkerResult() {
+            for (int op = 0; op < OperationCount; op++) failed[op] = 0;
         }
-        
-        Utility::pressEnterToContinue();
+    };
+    
+    // Swallows everything written to it
+    class NullBuffer : public streambuf {
+    protected:
+        int overflow(int c) override { return c == EOF ? 0 : c; }
+        streamsize xsputn(const char*, streamsize count) override { return count; }
+    };
+    
+    static string stationName(int index) {
+        return "Station " + to_string(index % 40 + 1);
     }
     
-    void changePassword() {
-        Utility::clearScreen();
-        cout << "\n===== CHANGE PASSWORD =====\n";
-        
-        string currentPassword = Utility::getInput("Enter current password: ");
+    static const char* operationName(int op) {
+        static const char* names[OperationCount] = { "search", "availability", "book", "cancel", "pay" };
+        return names[op];
+    }
+    
+    static double micros(uint64_t nanos) {
+        return nanos / 1000.0;
+    }
+    
+    static void report(const Config& config, size_t numTrains, double seconds, const WorkerResult& total) {
+        uint64_t operations = 0;
+        for (int op = 0; op < OperationCount; op++) operations += total.latency[op].getCount();
         
-        if (currentPassword != currentUser->getPassword()) {
-            cout << "Incorrect current password.\n";
-            Utility::pressEnterToContinue();
+        if (config.format == "json") {
+            cout << "{\"threads\": " << config.threads
+                 << ", \"operations_per_thread\": " << config.operationsPerThread
+                 << ", \"backend\": \"" << config.backend << "\""
+                 << ", \"trains\": " << numTrains
+                 << ", \"skew\": " << config.skew
+                 << ", \"group_min\": " << config.minGroupSize
+                 << ", \"group_max\": " << config.maxGroupSize
+                 << ", \"seconds\": " << fixed << setprecision(6) << seconds
+                 << ", \"throughput\": " << setprecision(1) << operations / seconds
+                 << ", \"operations\": {";
+            
+            for (int op = 0; op < OperationCount; op++) {
+                const LatencyHistogram& h = total.latency[op];
+                cout << (op ? ", " : "") << "\"" << operationName(op) << "\": {"
+                     << "\"count\": " << h.getCount()
+                     << ", \"failed\": " << total.failed[op]
+                     << ", \"throughput\": " << setprecision(1) << h.getCount() / seconds
+                     << setprecision(3)
+                     << ", \"mean_us\": " << micros((uint64_t)h.getMean())
+                     << ", \"p50_us\": " << micros(h.percentile(50))
+                     << ", \"p99_us\": " << micros(h.percentile(99))
+                     << ", \"p999_us\": " << micros(h.percentile(99.9))
+                     << ", \"max_us\": " << micros(h.getMax()) << "}";
+            }
+            cout << "}}" << endl;
             return;
         }
         
-        string newPassword = Utility::getInput("Enter new password: ");
-        string confirmPassword = Utility::getInput("Confirm new password: ");
-        
-        if (newPassword != confirmPassword) {
-            cout << "Passwords do not match.\n";
-            Utility::pressEnterToContinue();
+        if (config.format == "csv") {
+            cout << "operation,count,failed,throughput,mean_us,p50_us,p99_us,p999_us,max_us\n";
+            for (int op = 0; op < OperationCount; op++) {
+                const LatencyHistogram& h = total.latency[op];
+                cout << operationName(op) << "," << h.getCount() << "," << total.failed[op] << ","
+                     << fixed << setprecision(1) << h.getCount() / seconds << "," << setprecision(3)
+                     << micros((uint64_t)h.getMean()) << "," << micros(h.percentile(50)) << ","
+                     << micros(h.percentile(99)) << "," << micros(h.percentile(99.9)) << ","
+                     << micros(h.getMax()) << "\n";
+            }
             return;
         }
         
-        if (userManager->changePassword(currentUser->getUserId(), newPassword)) {
-            // Update current user's password in memory
-            currentUser->setPassword(newPassword);
-            cout << "Password changed successfully!\n";
-        } else {
-            cout << "Failed to change password. Please try again.\n";
-        }
+        cout << "Booking benchmark: " << config.threads << " threads x " << config.operationsPerThread
+             << " operations, " << config.backend << " backend, " << numTrains << " trains, skew "
+             << config.skew << ", groups " << config.minGroupSize << "-" << config.maxGroupSize << endl;
+        cout << "Total: " << operations << " operations in " << fixed << setprecision(2) << seconds
+             << " s (" << setprecision(0) << operations / seconds << " ops/s)\n\n";
         
-        Utility::pressEnterToContinue();
+        cout << left << setw(14) << "Operation" << right << setw(10) << "Count" << setw(9) << "Failed"
+             << setw(12) << "Ops/s" << setw(11) << "Mean(us)" << setw(11) << "p50(us)"
+             << setw(11) << "p99(us)" << setw(12) << "p99.9(us)" << setw(11) << "Max(us)" << endl;
+        cout << string(101, '-') << endl;
+        
+        for (int op = 0; op < OperationCount; op++) {
+            const LatencyHistogram& h = total.latency[op];
+            cout << left << setw(14) << operationName(op) << right << setw(10) << h.getCount()
+                 << setw(9) << total.failed[op] << setw(12) << setprecision(0) << h.getCount() / seconds
+                 << setprecision(1) << setw(11) << micros((uint64_t)h.getMean())
+                 << setw(11) << micros(h.percentile(50)) << setw(11) << micros(h.percentile(99))
+                 << setw(12) << micros(h.percentile(99.9)) << setw(11) << micros(h.getMax()) << endl;
+        }
     }
-    
+};
+
+// Drives the session store the way the server does: each thread checks random live
+// tokens, with logins (credential lookup plus a new token) and logouts mixed in. The
+// login row shows the storage lookup that a token check saves on every request.
+class SessionBenchmark {
 public:
-    Menu() {
-        dbConnector = new DatabaseConnector();
-        userManager = new UserManager(dbConnector);
-        trainManager = new TrainManager(dbConnector);
-        bookingManager = new BookingManager(dbConnector, trainManager);
-        paymentSystem = new PaymentSystem(dbConnector, bookingManager);
-        currentUser = nullptr;
-    }
+    struct Config {
+        int threads;
+        int operationsPerThread;
+        int sessions; // Live tokens at the start, spread over the threads
+        int authWeight;
+        int loginWeight;
+        int logoutWeight;
+        int shards;
+        unsigned int seed;
+        string backend;
+        
+        Config() : threads(8), operationsPerThread(200000), sessions(100000), authWeight(98), loginWeight(1),
+                   logoutWeight(1), shards(64), seed(1), backend("memory") {}
+    };
     
-    ~Menu() {
-        delete dbConnector;
-        delete userManager;
-        delete trainManager;
-        delete bookingManager;
-        delete paymentSystem;
-        delete currentUser;
+    // Parse key=value arguments; false (with a message) on anything unrecognised
+    static bool parseConfig(int argc, char* argv[], Config& config) {
+        for (int i = 0; i < argc; i++) {
+            string arg = argv[i];
+            size_t eq = arg.find('=');
+            string key = arg.substr(0, eq);
+            string value = eq == string::npos ? "" : arg.substr(eq + 1);
+            
+            if (key == "threads") config.threads = atoi(value.c_str());
+            else if (key == "ops") config.operationsPerThread = atoi(value.c_str());
+            else if (key == "sessions") config.sessions = atoi(value.c_str());
+            else if (key == "auth") config.authWeight = atoi(value.c_str());
+            else if (key == "login") config.loginWeight = atoi(value.c_str());
+            else if (key == "logout") config.logoutWeight = atoi(value.c_str());
+            else if (key == "shards") config.shards = atoi(value.c_str());
+            else if (key == "seed") config.seed = (unsigned int)strtoul(value.c_str(), nullptr, 10);
+            else if (key == "backend") config.backend = value;
+            else {
+                cerr << "Unknown benchmark option: " << arg << endl;
+                return false;
+            }
+        }
+        
+        if (config.threads < 1 || config.operationsPerThread < 1 || config.sessions < config.threads ||
+            config.shards < 1 || config.authWeight < 0 || config.loginWeight < 0 || config.logoutWeight < 0 ||
+            config.authWeight + config.loginWeight + config.logoutWeight == 0 ||
+            (config.backend != "memory" && config.backend != "mysql")) {
+            cerr << "Invalid benchmark configuration" << endl;
+            return false;
+        }
+        return true;
     }
     
-    void run() {
-        int choice;
-        bool running = true;
+    static bool run(const Config& config) {
+        StorageBackend* backend = config.backend == "mysql" ? (StorageBackend*)new MySqlBackend()
+                                                            : (StorageBackend*)new InMemoryBackend();
+        UserRepository* users = backend->users();
+        UserManager userManager(users);
+        SessionStore store(chrono::seconds(30 * 60), config.shards);
         
-        while (running) {
-            if (!currentUser) {
-                // Main menu (not logged in)
-                displayMainMenu();
-                choice = Utility::getIntInput("");
+        // One user per thread; every thread starts with its share of the live tokens
+        vector<string> usernames;
+        vector<vector<string>> tokens(config.threads);
+        string runTag = to_string(time(nullptr));
+        
+        for (int t = 0; t < config.threads; t++) {
+            string name = "sessions_" + runTag + "_" + to_string(t);
+            User user(0, name, "bench", "Benchmark User", name + "@bench.local", "0000000000", "");
+            if (!userManager.registerUser(user)) {
+                cerr << "Benchmark setup failed: cannot register users" << endl;
+                delete backend;
+                return false;
+            }
+            
+            usernames.push_back(name);
+            for (int i = t; i < config.sessions; i += config.threads) {
+                tokens[t].push_back(store.create(user));
+            }
+        }
+        
+        vector<WorkerResult> results(config.threads);
+        vector<thread> workers;
+        atomic<int> ready(0);
+        atomic<bool> go(false);
+        chrono::steady_clock::time_point start;
+        
+        for (int t = 0; t < config.threads; t++) {
+            workers.push_back(thread([&, t]() {
+                mt19937 rng(config.seed * 7919 + t);
+                discrete_distribution<int> operation({
+                    (double)config.authWeight, (double)config.loginWeight, (double)config.logoutWeight });
+                vector<string>& held = tokens[t];
+                WorkerResult& result = results[t];
                 
-                switch (choice) {
-                    case 1: // Login
-                        if (loginUser()) {
-                            runUserMenu();
+                ready++;
+                while (!go.load()) this_thread::yield();
+                
+                for (int i = 0; i < config.operationsPerThread; i++) {
+                    int op = operation(rng);
+                    if (op == Logout && held.empty()) op = Login;
+                    
+                    bool ok = true;
+                    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+                    
+                    switch (op) {
+                        case Auth: {
+                            uniform_int_distribution<size_t> pick(0, held.empty() ? 0 : held.size() - 1);
+                            ok = !held.empty() && store.find(held[pick(rng)]) != nullptr;
+                            break;
                         }
-                        break;
-                    case 2: // Register
-                        registerUser();
-                        break;
-                    case 3: // Exit
-                        running = false;
-                        cout << "Thank you for using Railway Ticket Booking System. Goodbye!\n";
-                        break;
-                    default:
-                        cout << "Invalid choice. Please try again.\n";
-                        Utility::pressEnterToContinue();
+                        case Login: {
+                            unique_ptr<User> user(users->findUserByCredentials(usernames[t], "bench"));
+                            ok = user != nullptr;
+                            if (ok) held.push_back(store.create(*user));
+                            break;
+                        }
+                        case Logout: {
+                            uniform_int_distribution<size_t> pick(0, held.size() - 1);
+                            size_t index = pick(rng);
+                            ok = store.revoke(held[index]);
+                            held[index].swap(held.back());
+                            held.pop_back();
+                            break;
+                        }
+                    }
+                    
+                    uint64_t elapsed = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+                        chrono::steady_clock::now() - begin).count();
+                    result.latency[op].record(elapsed);
+                    if (!ok) result.failed[op]++;
                 }
-            } else {
-                runUserMenu();
-                // User logged out
-                currentUser = nullptr;
+            }));
+        }
+        
+        while (ready.load() < config.threads) this_thread::yield();
+        start = chrono::steady_clock::now();
+        go = true;
+        
+        for (auto& worker : workers) worker.join();
+        
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        
+        WorkerResult total;
+        for (const auto& result : results) {
+            for (int op = 0; op < OperationCount; op++) {
+                total.latency[op].merge(result.latency[op]);
+                total.failed[op] += result.failed[op];
             }
         }
+        
+        uint64_t operations = 0;
+        for (int op = 0; op < OperationCount; op++) operations += total.latency[op].getCount();
+        
+        cout << "Session benchmark: " << config.threads << " threads x " << config.operationsPerThread
+             << " operations, " << config.backend << " backend, " << config.shards << " shards, "
+             << store.size() << " live sessions at the end" << endl;
+        cout << "Total: " << operations << " operations in " << fixed << setprecision(2) << seconds
+             << " s (" << setprecision(0) << operations / seconds << " ops/s)\n\n";
+        
+        cout << left << setw(14) << "Operation" << right << setw(10) << "Count" << setw(9) << "Failed"
+             << setw(12) << "Ops/s" << setw(11) << "Mean(us)" << setw(11) << "p50(us)"
+             << setw(11) << "p99(us)" << setw(12) << "p99.9(us)" << setw(11) << "Max(us)" << endl;
+        cout << string(101, '-') << endl;
+        
+        for (int op = 0; op < OperationCount; op++) {
+            const LatencyHistogram& h = total.latency[op];
+            cout << left << setw(14) << operationName(op) << right << setw(10) << h.getCount()
+                 << setw(9) << total.failed[op] << setw(12) << setprecision(0) << h.getCount() / seconds
+                 << setprecision(2) << setw(11) << h.getMean() / 1000.0
+                 << setw(11) << h.percentile(50) / 1000.0 << setw(11) << h.percentile(99) / 1000.0
+                 << setw(12) << h.percentile(99.9) / 1000.0 << setw(11) << h.getMax() / 1000.0 << endl;
+        }
+        
+        delete backend;
+        return true;
     }
+
+private:
+    enum Operation { Auth, Login, Logout, OperationCount };
     
-    void runUserMenu() {
-        int choice;
-        bool userLoggedIn = true;
+    struct WorkerResult {
+        LatencyHistogram latency[OperationCount];
+        uint64_t failed[OperationCount];
         
-        while (userLoggedIn) {
-            displayUserMenu();
-            choice = Utility::getIntInput("");
-            
-            switch (choice) {
-                case 1: // Search Trains
-                    searchTrains();
-                    break;
-                case 2: // View All Trains
-                    viewAllTrains();
-                    break;
-                case 3: // Book Ticket
-                    bookTicket();
-                    break;
-                case 4: // View My Bookings
-                    viewMyBookings();
-                    break;
-                case 5: // Cancel Booking
-                    cancelBooking();
-                    break;
-                case 6: // Update Profile
-                    updateProfile();
-                    break;
-                case 7: // Change Password
-                    changePassword();
-                    break;
-                case 8: // Logout
-                    userLoggedIn = false;
-                    cout << "Logged out successfully.\n";
-                    Utility::pressEnterToContinue();
-                    break;
-                default:
-                    cout << "Invalid choice. Please try again.\n";
-                    Utility::pressEnterToContinue();
-            }
+        WorkerResult() {
+            for (int op = 0; op < OperationCount; op++) failed[op] = 0;
         }
+    };
+    
+    static const char* operationName(int op) {
+        static const char* names[OperationCount] = { "auth", "login", "logout" };
+        return names[op];
     }
 };
 
 // ============= MAIN FUNCTION =============
-int main() {
-    cout << "Initializing Railway Ticket Booking System...\n";
-    
+int main(int argc, char* argv[]) {
+    // Startup failures, such as an unreachable database, surface as exceptions
     try {
-        Menu bookingSystem;
-        bookingSystem.run();
+        if (argc > 1 && string(argv[1]) == "--stress") {
+            int numThreads = argc > 2 ? atoi(argv[2]) : 8;
+            int requestsPerThread = argc > 3 ? atoi(argv[3]) : 100000;
+            int totalSeats = argc > 4 ? atoi(argv[4]) : 500;
+            return ReservationStressTest::run(numThreads, requestsPerThread, totalSeats) ? 0 : 1;
+        }
+        
+        if (argc > 1 && string(argv[1]) == "--bench") {
+            BookingBenchmark::Config config;
+            if (!BookingBenchmark::parseConfig(argc - 2, argv + 2, config)) {
+                return 1;
+            }
+            return BookingBenchmark::run(config) ? 0 : 1;
+        }
+        
+        if (argc > 1 && string(argv[1]) == "--bench-sessions") {
+            SessionBenchmark::Config config;
+            if (!SessionBenchmark::parseConfig(argc - 2, argv + 2, config)) {
+                return 1;
+            }
+            return SessionBenchmark::run(config) ? 0 : 1;
+        }
+        
+        if (argc > 1 && string(argv[1]) == "--batch") {
+            // Usage: --batch [--in-memory] [command file]; commands come from stdin without a file
+            bool inMemory = false;
+            string path;
+            for (int i = 2; i < argc; i++) {
+                if (string(argv[i]) == "--in-memory") inMemory = true;
+                else path = argv[i];
+            }
+            
+            ios::sync_with_stdio(false);
+            
+            ifstream file;
+            if (!path.empty()) {
+                file.open(path.c_str());
+                if (!file) {
+                    cerr << "Cannot open " << path << endl;
+                    return 1;
+                }
+            }
+            
+            StorageBackend* backend;
+            if (inMemory) {
+                InMemoryBackend* memory = new InMemoryBackend();
+                memory->addSampleTrains();
+                backend = memory;
+            } else {
+                backend = new MySqlBackend();
+            }
+            
+            CommandInterpreter interpreter(backend);
+            return BatchRunner::run(interpreter, path.empty() ? cin : file, cout) == 0 ? 0 : 1;
+        }
+        
+        if (argc > 1 && string(argv[1]) == "--serve") {
+#ifdef __linux__
+            // Usage: --serve [--in-memory] [--host address] [port] [workers]
+            bool inMemory = false;
+            string host = "127.0.0.1";
+            vector<int> numbers;
+            for (int i = 2; i < argc; i++) {
+                string arg = argv[i];
+                if (arg == "--in-memory") inMemory = true;
+                else if (arg == "--host" && i + 1 < argc) host = argv[++i];
+                else numbers.push_back(atoi(arg.c_str()));
+            }
+            int port = numbers.size() > 0 ? numbers[0] : 7070;
+            int numWorkers = numbers.size() > 1 ? numbers[1] : (int)max(thread::hardware_concurrency(), 2u);
+            
+            StorageBackend* backend;
+            if (inMemory) {
+                InMemoryBackend* memory = new InMemoryBackend();
+                memory->addSampleTrains();
+                backend = memory;
+            } else {
+                backend = new MySqlBackend();
+            }
+            
+            CommandInterpreter interpreter(backend);
+            BookingServer server(&interpreter, host, port, numWorkers);
+            if (!server.start()) {
+                return 1;
+            }
+            
+            static BookingServer* activeServer = &server;
+            signal(SIGINT, [](int) { activeServer->stop(); });
+            signal(SIGTERM, [](int) { activeServer->stop(); });
+            
+            cout << "Listening on " << host << ":" << server.getPort() << " with " << numWorkers << " workers" << endl;
+            server.run();
+            cout << "Server stopped" << endl;
+            return 0;
+#else
+            cerr << "Server mode needs Linux (epoll)" << endl;
+            return 1;
+#endif
+        }
+        
+        cout << "Initializing Railway Ticket Booking System...\n";
+        
+        if (argc > 1 && string(argv[1]) == "--in-memory") {
+            // No database server needed; data lives until the program exits
+            InMemoryBackend* backend = new InMemoryBackend();
+            backend->addSampleTrains();
+            
+            Menu bookingSystem(backend);
+            bookingSystem.run();
+        } else {
+            Menu bookingSystem;
+            bookingSystem.run();
+        }
     } catch (const exception& e) {
         cerr << "Error: " << e.what() << endl;
         return 1;